@@ -0,0 +1,338 @@
+#include "../smt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ *  Wirelength quality harness for SMT engines
+ *
+ *  Usage: quality_bench.out [--nets N] [--csv path]
+ *
+ *  Every engine builds the same corpus of nets generated with fixed
+ *  seeds. Small nets (3-10 pins) are compared with exact optima found
+ *  by Dreyfus-Wagner over the Hanan grid, all nets are compared with
+ *  the rectilinear MST. For every engine and net size it reports mean
+ *  improvement over RMST, mean and max gap to the optimum and mean
+ *  build time. Lengths are the ones BuildSMT returns
+ */
+
+struct Pin
+{
+    long long x;
+    long long y;
+};
+
+struct Net
+{
+    unsigned grid_size;
+    std::vector<Pin> pins;
+    long long rmst;
+    long long optimum;
+};
+
+struct Engine
+{
+    const char* name;
+    std::function<SMT::Length( SMT&)> build;
+};
+
+struct Summary
+{
+    unsigned nets;
+    double improvement;
+    double gap;
+    double max_gap;
+    unsigned optimal_nets;
+    double time;
+};
+
+static const unsigned max_exact_pins = 10;
+
+static long long Distance( const Pin& pin1, const Pin& pin2)
+{
+    return std::abs( pin1.x - pin2.x) + std::abs( pin1.y - pin2.y);
+}
+
+/** Prim's algorithm on the complete graph of pins */
+static long long CalculateRMST( const std::vector<Pin>& pins)
+{
+    std::vector<long long> distance( pins.size(), -1);
+    std::vector<bool> is_linked( pins.size(), false);
+    long long length = 0;
+
+    distance[ 0] = 0;
+
+    for ( unsigned step = 0; step < pins.size(); ++step)
+    {
+        unsigned next = pins.size();
+
+        for ( unsigned i = 0; i < pins.size(); ++i)
+        {
+            if ( !is_linked[ i]
+                 && distance[ i] >= 0
+                 && ( next == pins.size() || distance[ i] < distance[ next] ) )
+                next = i;
+        }
+
+        is_linked[ next] = true;
+        length += distance[ next];
+
+        for ( unsigned i = 0; i < pins.size(); ++i)
+        {
+            long long new_distance = Distance( pins[ next], pins[ i]);
+
+            if ( !is_linked[ i]
+                 && ( distance[ i] < 0 || new_distance < distance[ i] ) )
+                distance[ i] = new_distance;
+        }
+    }
+
+    return length;
+}
+
+/**
+ *  Dreyfus-Wagner over Hanan points: tree[ set][ v] is the shortest tree
+ *  connecting pins of the set and point v. Distances of the Hanan grid
+ *  are Manhattan ones, so paths need no graph search
+ */
+static long long CalculateOptimum( const std::vector<Pin>& pins)
+{
+    std::vector<long long> xs;
+    std::vector<long long> ys;
+    std::vector<Pin> points;
+
+    for ( auto it = pins.begin(); it != pins.end(); ++it)
+    {
+        xs.push_back( it->x);
+        ys.push_back( it->y);
+    }
+
+    std::sort( xs.begin(), xs.end());
+    xs.erase( std::unique( xs.begin(), xs.end()), xs.end());
+    std::sort( ys.begin(), ys.end());
+    ys.erase( std::unique( ys.begin(), ys.end()), ys.end());
+
+    for ( auto it_x = xs.begin(); it_x != xs.end(); ++it_x)
+    {
+        for ( auto it_y = ys.begin(); it_y != ys.end(); ++it_y)
+        {
+            Pin point = { *it_x, *it_y };
+            points.push_back( point);
+        }
+    }
+
+    /** The last pin is the root, sets are taken from the others */
+    unsigned terminals = pins.size() - 1;
+    unsigned count = points.size();
+    std::vector<std::vector<long long> > tree( 1u << terminals, std::vector<long long>( count));
+
+    for ( unsigned t = 0; t < terminals; ++t)
+    {
+        for ( unsigned v = 0; v < count; ++v)
+            tree[ 1u << t][ v] = Distance( pins[ t], points[ v]);
+    }
+
+    for ( unsigned set = 1; set < ( 1u << terminals); ++set)
+    {
+        if ( !( set & ( set - 1)) )
+            continue;
+
+        std::vector<long long>& res = tree[ set];
+
+        for ( unsigned v = 0; v < count; ++v)
+        {
+            long long best = -1;
+
+            /** Subsets with the lowest pin of the set, so every split is seen once */
+            unsigned low = set & ( ~set + 1);
+
+            for ( unsigned part = ( set - 1) & set; part; part = ( part - 1) & set)
+            {
+                if ( !( part & low) )
+                    continue;
+
+                long long length = tree[ part][ v] + tree[ set ^ part][ v];
+
+                if ( best < 0 || length < best )
+                    best = length;
+            }
+
+            res[ v] = best;
+        }
+
+        for ( unsigned v = 0; v < count; ++v)
+        {
+            for ( unsigned u = 0; u < count; ++u)
+                res[ v] = std::min( res[ v], res[ u] + Distance( points[ u], points[ v]));
+        }
+    }
+
+    const std::vector<long long>& all = tree[ ( 1u << terminals) - 1];
+    long long best = -1;
+
+    for ( unsigned v = 0; v < count; ++v)
+    {
+        long long length = all[ v] + Distance( points[ v], pins.back());
+
+        if ( best < 0 || length < best )
+            best = length;
+    }
+
+    return best;
+}
+
+static std::vector<Net> GenerateCorpus( unsigned nets_per_size)
+{
+    std::vector<Net> corpus;
+    unsigned sizes[] = { 3, 4, 5, 6, 7, 8, 9, 10, 20, 40 };
+
+    for ( unsigned i = 0; i < sizeof( sizes) / sizeof( sizes[ 0]); ++i)
+    {
+        std::mt19937 gen( 7919u * sizes[ i]);
+
+        for ( unsigned n = 0; n < nets_per_size; ++n)
+        {
+            Net net;
+            net.grid_size = 10 * sizes[ i];
+
+            std::uniform_int_distribution<long long> coord( 0, net.grid_size - 1);
+
+            /** Pins are distinct, so the number of pins is what it says */
+            while ( net.pins.size() < sizes[ i] )
+            {
+                Pin pin = { coord( gen), coord( gen) };
+                bool is_taken = false;
+
+                for ( auto it = net.pins.begin(); it != net.pins.end(); ++it)
+                    is_taken = is_taken || ( it->x == pin.x && it->y == pin.y );
+
+                if ( !is_taken )
+                    net.pins.push_back( pin);
+            }
+
+            net.rmst = CalculateRMST( net.pins);
+            net.optimum = sizes[ i] <= max_exact_pins ? CalculateOptimum( net.pins) : -1;
+            corpus.push_back( net);
+        }
+    }
+
+    return corpus;
+}
+
+static bool ParseOptions( int argc, char** argv, unsigned& nets_per_size, const char*& csv_path)
+{
+    nets_per_size = 20;
+    csv_path = nullptr;
+
+    for ( int i = 1; i < argc; ++i)
+    {
+        if ( i + 1 == argc )
+            return false;
+
+        const char* value = argv[ ++i];
+
+        if ( !strcmp( argv[ i - 1], "--nets") )
+            nets_per_size = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--csv") )
+            csv_path = value;
+        else
+            return false;
+    }
+
+    return nets_per_size > 0;
+}
+
+int main( int argc, char** argv)
+{
+    unsigned nets_per_size;
+    const char* csv_path;
+
+    if ( !ParseOptions( argc, argv, nets_per_size, csv_path) )
+    {
+        std::cerr << "Usage: " << argv[ 0] << " [--nets N] [--csv path]\n";
+        return 1;
+    }
+
+    Executor executor( 4);
+    std::vector<Engine> engines;
+
+    engines.push_back( Engine{ "1-steiner", []( SMT& smt) { return smt.BuildSMT(); } });
+    engines.push_back( Engine{ "1-steiner-parallel", [ &executor]( SMT& smt)
+    {
+        smt.SetExecutor( &executor);
+        return smt.BuildSMT();
+    } });
+    engines.push_back( Engine{ "first-round", []( SMT& smt)
+    {
+        SMT::Limits limits;
+        limits.SetMaxIterations( 1);
+        smt.SetLimits( limits);
+        return smt.BuildSMT();
+    } });
+    engines.push_back( Engine{ "mst", []( SMT& smt) { return smt.BuildSMTFromSeeds(); } });
+
+    std::vector<Net> corpus = GenerateCorpus( nets_per_size);
+    std::ofstream csv_file;
+
+    if ( csv_path )
+        csv_file.open( csv_path);
+
+    std::ostream& output = csv_path ? csv_file : std::cout;
+
+    output << "engine,pins,nets,improvement_over_rmst_pct,gap_to_optimum_pct,max_gap_pct,optimal_nets,time_ms\n";
+
+    for ( auto engine = engines.begin();
+          engine != engines.end();
+          ++engine)
+    {
+        for ( unsigned first = 0, last; first < corpus.size(); first = last)
+        {
+            Summary summary = { 0, 0, 0, 0, 0, 0 };
+            unsigned pins_count = corpus[ first].pins.size();
+
+            for ( last = first; last < corpus.size() && corpus[ last].pins.size() == pins_count; ++last)
+            {
+                const Net& net = corpus[ last];
+                SMT smt( net.grid_size, pins_count);
+
+                for ( auto it = net.pins.begin(); it != net.pins.end(); ++it)
+                    smt.AddPin( it->x, it->y);
+
+                auto start = std::chrono::steady_clock::now();
+                long long length = engine->build( smt);
+                auto stop = std::chrono::steady_clock::now();
+
+                summary.nets++;
+                summary.time += std::chrono::duration<double, std::milli>( stop - start).count();
+                summary.improvement += net.rmst ? 100.0 * ( net.rmst - length) / net.rmst : 0;
+
+                if ( net.optimum < 0 )
+                    continue;
+
+                double gap = net.optimum ? 100.0 * ( length - net.optimum) / net.optimum : 0;
+
+                summary.gap += gap;
+                summary.max_gap = std::max( summary.max_gap, gap);
+                summary.optimal_nets += length == net.optimum ? 1 : 0;
+            }
+
+            output << engine->name << "," << pins_count << "," << summary.nets << ","
+                   << summary.improvement / summary.nets << ",";
+
+            if ( pins_count <= max_exact_pins )
+                output << summary.gap / summary.nets << "," << summary.max_gap << "," << summary.optimal_nets << ",";
+            else
+                output << ",,,";
+
+            output << summary.time / summary.nets << "\n";
+        }
+    }
+
+    return 0;
+}
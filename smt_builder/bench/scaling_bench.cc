@@ -0,0 +1,470 @@
+#include "../smt.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ *  Scaling sweep for SMT building
+ *
+ *  Usage: scaling_bench.out [--pins 3,10,100] [--grids 50,1000]
+ *                           [--grid G] [--pins-at P] [--reps R]
+ *                           [--budget seconds]
+ *                           [--memory-limit MB] [--tolerance T]
+ *                           [--csv path]
+ *
+ *  Pin sweep builds nets of growing pin count on a G x G grid (1000 by
+ *  default), grid sweep builds P pins (20 by default) on growing grids.
+ *  Every case runs in a forked process, so peak RSS is its own and a
+ *  case that runs out of memory or time doesn't take the sweep down.
+ *  Timings are minimums of R runs (3 by default):
+ *
+ *      add_pins   - AddPin calls, it includes edges insertion
+ *      hanan      - Hanan points collection
+ *      candidate  - candidate loop time divided by candidates checked
+ *      build      - whole BuildSMT, only for converged cases
+ *      rss        - peak resident set size in MB
+ *
+ *  Build is bounded by the budget (10 s by default) and the whole case
+ *  by twice the budget. Once a case runs out of time or memory bigger
+ *  ones of that sweep are skipped. Then every metric gets an empirical
+ *  exponent, a least squares fit of log( value) on log( size), and the
+ *  max exponent between neighbouring sizes. A metric is flagged when
+ *  either of them exceeds its expected exponent by more than tolerance
+ *  (0.3 by default). Expected exponents are complexities of the current
+ *  code: all pairs edges kept in a sorted list make AddPin O( n^4), each
+ *  of O( n^2) candidates inserts n edges into that list. Nothing should
+ *  depend on grid size
+ */
+
+enum Metric
+{
+    AddPins,
+    Hanan,
+    Candidate,
+    Build,
+    Rss,
+    Metrics
+};
+
+static const char* metric_names[ Metrics] = { "add_pins", "hanan", "candidate", "build", "rss" };
+
+/** Values below that are timer noise and aren't fitted */
+static const double min_fitted_time = 1e-5;
+
+enum Status
+{
+    Done,
+    NotConverged,
+    OutOfTime,
+    OutOfMemory,
+    Skipped
+};
+
+static const char* status_names[] = { "done", "not_converged", "out_of_time", "out_of_memory", "skipped" };
+
+struct Sweep
+{
+    const char* name;
+    std::vector<unsigned> sizes;
+    double expected[ Metrics];
+};
+
+struct Sample
+{
+    unsigned size;
+    unsigned pins;
+    unsigned grid_size;
+    Status status;
+    double values[ Metrics];
+};
+
+struct Options
+{
+    std::vector<unsigned> pins;
+    std::vector<unsigned> grids;
+    unsigned grid_size;
+    unsigned pins_count;
+    unsigned reps;
+    double budget;
+    unsigned memory_limit;
+    double tolerance;
+    const char* csv_path;
+};
+
+/** What a forked case sends back to the sweep */
+struct Report
+{
+    Status status;
+    double values[ Metrics];
+};
+
+/**
+ *  Pins are placed on a base x base grid and stretched to the grid size,
+ *  so nets of one pin count differ only in scale and grid sweep measures
+ *  grid size alone
+ */
+static Report RunCase( unsigned pins_count, unsigned grid_size, unsigned base, double budget)
+{
+    /** Seed depends only on the pin count, so every run builds the same nets */
+    std::mt19937 gen( 1000003u * pins_count);
+    std::uniform_int_distribution<unsigned> coord( 0, base - 1);
+    unsigned scale = grid_size / base;
+    Report report;
+    SMT smt( grid_size, pins_count);
+    SMT::Limits limits;
+
+    limits.SetTimeLimit( std::chrono::duration_cast<SMT::Limits::Clock::duration>(
+                             std::chrono::duration<double>( budget)));
+    smt.SetLimits( limits);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for ( unsigned i = 0; i < pins_count; ++i)
+    {
+        unsigned x = coord( gen) * scale;
+        smt.AddPin( x, coord( gen) * scale);
+    }
+
+    auto built = std::chrono::steady_clock::now();
+    smt.BuildSMT();
+    auto stop = std::chrono::steady_clock::now();
+
+    const SMT::Stats& stats = smt.GetStats();
+    struct rusage usage;
+
+    getrusage( RUSAGE_SELF, &usage);
+
+    report.status = smt.IsConverged() ? Done : NotConverged;
+    report.values[ AddPins] = std::chrono::duration<double>( built - start).count();
+    report.values[ Hanan] = stats.hanan_time;
+    report.values[ Candidate] = stats.evaluations ? stats.iterations_time / stats.evaluations : 0;
+    report.values[ Build] = std::chrono::duration<double>( stop - built).count();
+    report.values[ Rss] = usage.ru_maxrss / 1024.0;
+
+    return report;
+}
+
+static Report RunForked( const Options& options, unsigned pins_count, unsigned grid_size, unsigned base)
+{
+    Report report;
+    int fds[ 2];
+
+    memset( &report, 0, sizeof( report));
+    report.status = OutOfMemory;
+
+    if ( pipe( fds) )
+        return report;
+
+    pid_t pid = fork();
+
+    if ( pid == 0 )
+    {
+        struct rlimit memory = { options.memory_limit * 1024ul * 1024ul, options.memory_limit * 1024ul * 1024ul };
+
+        close( fds[ 0]);
+        setrlimit( RLIMIT_AS, &memory);
+        alarm( static_cast<unsigned>( std::ceil( 2 * options.budget)));
+
+        try
+        {
+            /** Timings are minimums of reps, repeats stop once the case has used its budget */
+            auto start = std::chrono::steady_clock::now();
+
+            report = RunCase( pins_count, grid_size, base, options.budget);
+
+            for ( unsigned rep = 1;
+                  rep < options.reps
+                  && std::chrono::duration<double>( std::chrono::steady_clock::now() - start).count() < options.budget;
+                  ++rep)
+            {
+                Report next = RunCase( pins_count, grid_size, base, options.budget);
+
+                for ( unsigned metric = 0; metric < Rss; ++metric)
+                    report.values[ metric] = std::min( report.values[ metric], next.values[ metric]);
+
+                report.values[ Rss] = next.values[ Rss];
+            }
+        }
+        catch ( const std::bad_alloc&)
+        {
+            report.status = OutOfMemory;
+        }
+
+        ssize_t written = write( fds[ 1], &report, sizeof( report));
+        _exit( written == sizeof( report) ? 0 : 1);
+    }
+
+    close( fds[ 1]);
+
+    ssize_t got = pid > 0 ? read( fds[ 0], &report, sizeof( report)) : 0;
+    int status = 0;
+
+    close( fds[ 0]);
+
+    if ( pid > 0 )
+        waitpid( pid, &status, 0);
+
+    if ( got != sizeof( report) )
+    {
+        memset( &report, 0, sizeof( report));
+        report.status = WIFSIGNALED( status) && WTERMSIG( status) == SIGALRM ? OutOfTime : OutOfMemory;
+    }
+
+    return report;
+}
+
+/** Slope of least squares line through ( log x, log y) */
+static double FitExponent( const std::vector<std::pair<double, double> >& points)
+{
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    double n = points.size();
+
+    for ( auto it = points.begin();
+          it != points.end();
+          ++it)
+    {
+        double x = std::log( it->first);
+        double y = std::log( it->second);
+
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    double denominator = n * sum_xx - sum_x * sum_x;
+
+    return denominator > 0 ? ( n * sum_xy - sum_x * sum_y) / denominator : 0;
+}
+
+static std::vector<Sample> RunSweep( const Options& options, const Sweep& sweep, bool is_pin_sweep)
+{
+    std::vector<Sample> samples;
+    bool is_stopped = false;
+
+    for ( auto it = sweep.sizes.begin();
+          it != sweep.sizes.end();
+          ++it)
+    {
+        Sample sample;
+
+        sample.size = *it;
+        sample.pins = is_pin_sweep ? *it : options.pins_count;
+        sample.grid_size = is_pin_sweep ? options.grid_size : *it;
+
+        if ( is_stopped )
+        {
+            memset( sample.values, 0, sizeof( sample.values));
+            sample.status = Skipped;
+        }
+        else
+        {
+            unsigned base = is_pin_sweep ? options.grid_size : sweep.sizes.front();
+            Report report = RunForked( options, sample.pins, sample.grid_size, base);
+
+            sample.status = report.status;
+            memcpy( sample.values, report.values, sizeof( sample.values));
+
+            /** Not converged builds still give add_pins, hanan and candidate */
+            is_stopped = report.status == OutOfTime || report.status == OutOfMemory;
+        }
+
+        std::cerr << sweep.name << " sweep " << sample.size << ": " << status_names[ sample.status] << "\n";
+        samples.push_back( sample);
+    }
+
+    return samples;
+}
+
+static void WriteResults( std::ostream& output, const Options& options,
+                          const Sweep& sweep, const std::vector<Sample>& samples)
+{
+    output << "# " << sweep.name << " sweep\n";
+    output << "sweep,size,pins,grid_size,status";
+
+    for ( unsigned metric = 0; metric < Metrics; ++metric)
+        output << "," << metric_names[ metric];
+
+    output << "\n";
+
+    for ( auto it = samples.begin();
+          it != samples.end();
+          ++it)
+    {
+        output << sweep.name << "," << it->size << "," << it->pins << "," << it->grid_size << ","
+               << status_names[ it->status];
+
+        for ( unsigned metric = 0; metric < Metrics; ++metric)
+            output << "," << it->values[ metric];
+
+        output << "\n";
+    }
+
+    output << "sweep,metric,points,exponent,max_local_exponent,expected,flag\n";
+
+    for ( unsigned metric = 0; metric < Metrics; ++metric)
+    {
+        std::vector<std::pair<double, double> > points;
+        double max_local = 0;
+
+        for ( auto it = samples.begin();
+              it != samples.end();
+              ++it)
+        {
+            /** Time to the limit says nothing about the build, the rest is still measured */
+            if ( it->status == Skipped
+                 || it->status == OutOfTime
+                 || it->status == OutOfMemory
+                 || ( it->status == NotConverged && metric == Build )
+                 || ( metric != Rss && it->values[ metric] < min_fitted_time )
+                 || it->values[ metric] <= 0 )
+                continue;
+
+            points.push_back( std::make_pair( it->size, it->values[ metric]));
+
+            if ( points.size() > 1 )
+            {
+                std::vector<std::pair<double, double> > pair( points.end() - 2, points.end());
+                max_local = std::max( max_local, FitExponent( pair));
+            }
+        }
+
+        double exponent = FitExponent( points);
+        double limit = sweep.expected[ metric] + options.tolerance;
+        bool is_flagged = points.size() > 1
+                          && ( exponent > limit || max_local > limit );
+
+        output << sweep.name << "," << metric_names[ metric] << "," << points.size() << ","
+               << exponent << "," << max_local << "," << sweep.expected[ metric] << ","
+               << ( is_flagged ? "superlinear" : "ok" ) << "\n";
+
+        if ( is_flagged )
+        {
+            std::cerr << sweep.name << " sweep: " << metric_names[ metric] << " grows as size^"
+                      << std::max( exponent, max_local) << ", expected size^" << sweep.expected[ metric] << "\n";
+        }
+    }
+}
+
+static bool ParseList( const char* value, std::vector<unsigned>& list)
+{
+    for ( char* pos = const_cast<char*>( value); *pos; )
+    {
+        list.push_back( strtoul( pos, &pos, 10));
+
+        if ( !list.back() )
+            return false;
+
+        if ( *pos == ',' )
+            ++pos;
+        else if ( *pos )
+            return false;
+    }
+
+    return true;
+}
+
+static bool ParseOptions( int argc, char** argv, Options& options)
+{
+    options.grid_size = 1000;
+    options.pins_count = 20;
+    options.reps = 3;
+    options.budget = 10;
+    options.memory_limit = 4096;
+    options.tolerance = 0.3;
+    options.csv_path = nullptr;
+
+    for ( int i = 1; i < argc; ++i)
+    {
+        if ( i + 1 == argc )
+            return false;
+
+        const char* value = argv[ ++i];
+
+        if ( !strcmp( argv[ i - 1], "--pins") )
+        {
+            if ( !ParseList( value, options.pins) )
+                return false;
+        }
+        else if ( !strcmp( argv[ i - 1], "--grids") )
+        {
+            if ( !ParseList( value, options.grids) )
+                return false;
+        }
+        else if ( !strcmp( argv[ i - 1], "--grid") )
+            options.grid_size = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--pins-at") )
+            options.pins_count = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--reps") )
+            options.reps = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--budget") )
+            options.budget = atof( value);
+        else if ( !strcmp( argv[ i - 1], "--memory-limit") )
+            options.memory_limit = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--tolerance") )
+            options.tolerance = atof( value);
+        else if ( !strcmp( argv[ i - 1], "--csv") )
+            options.csv_path = value;
+        else
+            return false;
+    }
+
+    if ( options.pins.empty() )
+        options.pins = { 3, 10, 30, 100, 300, 1000, 3000, 10000 };
+
+    if ( options.grids.empty() )
+        options.grids = { 50, 500, 5000, 50000, 500000, 1000000 };
+
+    for ( auto it = options.grids.begin();
+          it != options.grids.end();
+          ++it)
+    {
+        if ( *it % options.grids.front() )
+            return false;
+    }
+
+    return options.grid_size
+           && options.pins_count
+           && options.reps
+           && options.budget > 0;
+}
+
+int main( int argc, char** argv)
+{
+    Options options;
+
+    if ( !ParseOptions( argc, argv, options) )
+    {
+        std::cerr << "Usage: " << argv[ 0] << " [--pins 3,10,100] [--grids 50,1000] [--grid G] [--pins-at P] [--reps R]"
+                  << " [--budget seconds] [--memory-limit MB] [--tolerance T] [--csv path]\n";
+        return 1;
+    }
+
+    Sweep pin_sweep = { "pins", options.pins, { 4, 2, 3, 6, 2 } };
+    Sweep grid_sweep = { "grid", options.grids, { 0, 0, 0, 0, 0 } };
+    std::vector<Sample> pin_samples = RunSweep( options, pin_sweep, true);
+    std::vector<Sample> grid_samples = RunSweep( options, grid_sweep, false);
+    std::ofstream csv_file;
+
+    if ( options.csv_path )
+        csv_file.open( options.csv_path);
+
+    std::ostream& output = options.csv_path ? csv_file : std::cout;
+
+    WriteResults( output, options, pin_sweep, pin_samples);
+    WriteResults( output, options, grid_sweep, grid_samples);
+
+    return 0;
+}
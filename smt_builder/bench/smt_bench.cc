@@ -0,0 +1,371 @@
+#include "../smt.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ *  Benchmark suite for SMT building
+ *
+ *  Usage: smt_bench.out [--sizes 3,10,30] [--reps R] [--warmup W]
+ *                       [--time-limit seconds] [--threads T]
+ *                       [--csv path] [--json path]
+ *
+ *  Nets are generated in process with fixed seeds, pins are spread
+ *  uniformly, in clusters or along rows. Every net is built warmup
+ *  times without measuring and then reps times. Phases are timed by
+ *  SMT stats, so SMT has to be compiled with SMT_STATS:
+ *
+ *      add_pins  - AddPin calls, it includes edges insertion
+ *      mst       - first CalculateMST of BuildSMT
+ *      round     - one SMTIteration, iterations time divided by rounds
+ *                  started, the last one which finds nothing included
+ *      finalize  - FinalizeSMT
+ *      build     - whole BuildSMT
+ *
+ *  Min, median and mean of every metric are written as CSV to stdout
+ *  or to the given files. Builds are bounded by the time limit (10 s
+ *  by default), so big nets report time to the limit and not converged
+ */
+
+enum Distribution
+{
+    Uniform,
+    Clustered,
+    Rows,
+    Distributions
+};
+
+static const char* distribution_names[ Distributions] = { "uniform", "clustered", "rows" };
+
+struct Pin
+{
+    unsigned x;
+    unsigned y;
+};
+
+struct Net
+{
+    unsigned grid_size;
+    std::vector<Pin> pins;
+};
+
+struct Metric
+{
+    const char* name;
+    std::vector<double> values;
+};
+
+struct Result
+{
+    Distribution distribution;
+    unsigned pins;
+    SMT::Length length;
+    bool is_converged;
+    std::vector<Metric> metrics;
+};
+
+struct Options
+{
+    std::vector<unsigned> sizes;
+    unsigned reps;
+    unsigned warmup;
+    double time_limit;
+    unsigned threads;
+    const char* csv_path;
+    const char* json_path;
+};
+
+static Net GenerateNet( Distribution distribution, unsigned pins_count)
+{
+    /** Seed depends only on the case, so every run builds the same nets */
+    std::mt19937 gen( 1000003u * ( distribution + 1) + pins_count);
+    Net net;
+
+    net.grid_size = std::max( 16u, 8 * static_cast<unsigned>( std::ceil( std::sqrt( pins_count))));
+
+    std::uniform_int_distribution<unsigned> coord( 0, net.grid_size - 1);
+
+    if ( distribution == Uniform )
+    {
+        for ( unsigned i = 0; i < pins_count; ++i)
+        {
+            Pin pin = { coord( gen), coord( gen) };
+            net.pins.push_back( pin);
+        }
+    }
+    else if ( distribution == Clustered )
+    {
+        unsigned clusters_count = std::max( 1u, pins_count / 50);
+        std::vector<Pin> centers;
+        std::normal_distribution<double> shift( 0, net.grid_size / 20.0);
+
+        for ( unsigned i = 0; i < clusters_count; ++i)
+        {
+            Pin center = { coord( gen), coord( gen) };
+            centers.push_back( center);
+        }
+
+        for ( unsigned i = 0; i < pins_count; ++i)
+        {
+            const Pin& center = centers[ i % clusters_count];
+            double x = std::min<double>( std::max<double>( center.x + shift( gen), 0), net.grid_size - 1);
+            double y = std::min<double>( std::max<double>( center.y + shift( gen), 0), net.grid_size - 1);
+            Pin pin = { static_cast<unsigned>( x), static_cast<unsigned>( y) };
+            net.pins.push_back( pin);
+        }
+    }
+    else
+    {
+        unsigned rows_count = std::max( 3u, static_cast<unsigned>( std::sqrt( pins_count)) / 2);
+        std::uniform_int_distribution<unsigned> row( 0, rows_count - 1);
+
+        for ( unsigned i = 0; i < pins_count; ++i)
+        {
+            Pin pin = { coord( gen), row( gen) * ( net.grid_size / rows_count) };
+            net.pins.push_back( pin);
+        }
+    }
+
+    return net;
+}
+
+static double Seconds( std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point stop)
+{
+    return std::chrono::duration<double>( stop - start).count();
+}
+
+static Result RunCase( const Options& options, Distribution distribution, unsigned pins_count, Executor* executor)
+{
+    Net net = GenerateNet( distribution, pins_count);
+    Result res;
+    const char* names[] = { "add_pins", "mst", "round", "finalize", "build" };
+
+    res.distribution = distribution;
+    res.pins = pins_count;
+
+    for ( unsigned i = 0; i < sizeof( names) / sizeof( names[ 0]); ++i)
+    {
+        Metric metric = { names[ i], std::vector<double>() };
+        res.metrics.push_back( metric);
+    }
+
+    for ( unsigned rep = 0; rep < options.warmup + options.reps; ++rep)
+    {
+        SMT smt( net.grid_size, pins_count);
+        SMT::Limits limits;
+
+        limits.SetTimeLimit( std::chrono::duration_cast<SMT::Limits::Clock::duration>(
+                                 std::chrono::duration<double>( options.time_limit)));
+        smt.SetLimits( limits);
+        smt.SetExecutor( executor);
+
+        auto start = std::chrono::steady_clock::now();
+
+        for ( auto it = net.pins.begin();
+              it != net.pins.end();
+              ++it)
+        {
+            smt.AddPin( it->x, it->y);
+        }
+
+        auto built = std::chrono::steady_clock::now();
+        res.length = smt.BuildSMT();
+        auto stop = std::chrono::steady_clock::now();
+
+        res.is_converged = smt.IsConverged();
+
+        if ( rep < options.warmup )
+            continue;
+
+        const SMT::Stats& stats = smt.GetStats();
+
+        res.metrics[ 0].values.push_back( Seconds( start, built));
+        res.metrics[ 1].values.push_back( stats.mst_time);
+        res.metrics[ 2].values.push_back( stats.attempted_rounds ? stats.iterations_time / stats.attempted_rounds : 0);
+        res.metrics[ 3].values.push_back( stats.finalize_time);
+        res.metrics[ 4].values.push_back( Seconds( built, stop));
+    }
+
+    return res;
+}
+
+static void GetSummary( std::vector<double> values, double& min, double& median, double& mean)
+{
+    min = median = mean = 0;
+
+    if ( values.empty() )
+        return;
+
+    std::sort( values.begin(), values.end());
+
+    min = values.front();
+    median = values[ values.size() / 2];
+
+    for ( auto it = values.begin();
+          it != values.end();
+          ++it)
+    {
+        mean += *it;
+    }
+
+    mean /= values.size();
+}
+
+static void WriteCSV( std::ostream& output, const std::vector<Result>& results)
+{
+    output << "distribution,pins,metric,min,median,mean,length,converged\n";
+
+    for ( auto it = results.begin();
+          it != results.end();
+          ++it)
+    {
+        for ( auto metric = it->metrics.begin();
+              metric != it->metrics.end();
+              ++metric)
+        {
+            double min, median, mean;
+            GetSummary( metric->values, min, median, mean);
+
+            output << distribution_names[ it->distribution] << "," << it->pins << "," << metric->name << ","
+                   << min << "," << median << "," << mean << ","
+                   << it->length << "," << ( it->is_converged ? 1 : 0 ) << "\n";
+        }
+    }
+}
+
+static void WriteJSON( std::ostream& output, const std::vector<Result>& results)
+{
+    output << "[";
+
+    for ( auto it = results.begin();
+          it != results.end();
+          ++it)
+    {
+        output << ( it == results.begin() ? "\n" : ",\n")
+               << "{\"distribution\": \"" << distribution_names[ it->distribution]
+               << "\", \"pins\": " << it->pins
+               << ", \"length\": " << it->length
+               << ", \"converged\": " << ( it->is_converged ? "true" : "false" );
+
+        for ( auto metric = it->metrics.begin();
+              metric != it->metrics.end();
+              ++metric)
+        {
+            double min, median, mean;
+            GetSummary( metric->values, min, median, mean);
+
+            output << ", \"" << metric->name << "\": {\"min\": " << min
+                   << ", \"median\": " << median
+                   << ", \"mean\": " << mean << "}";
+        }
+
+        output << "}";
+    }
+
+    output << "\n]\n";
+}
+
+static bool ParseOptions( int argc, char** argv, Options& options)
+{
+    options.reps = 5;
+    options.warmup = 1;
+    options.time_limit = 10;
+    options.threads = 0;
+    options.csv_path = nullptr;
+    options.json_path = nullptr;
+
+    for ( int i = 1; i < argc; ++i)
+    {
+        if ( i + 1 == argc )
+            return false;
+
+        const char* value = argv[ ++i];
+
+        if ( !strcmp( argv[ i - 1], "--sizes") )
+        {
+            for ( char* pos = const_cast<char*>( value); *pos; )
+            {
+                options.sizes.push_back( strtoul( pos, &pos, 10));
+
+                if ( *pos == ',' )
+                    ++pos;
+                else if ( *pos )
+                    return false;
+            }
+        }
+        else if ( !strcmp( argv[ i - 1], "--reps") )
+            options.reps = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--warmup") )
+            options.warmup = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--time-limit") )
+            options.time_limit = atof( value);
+        else if ( !strcmp( argv[ i - 1], "--threads") )
+            options.threads = atoi( value);
+        else if ( !strcmp( argv[ i - 1], "--csv") )
+            options.csv_path = value;
+        else if ( !strcmp( argv[ i - 1], "--json") )
+            options.json_path = value;
+        else
+            return false;
+    }
+
+    /** Edges of all pairs are kept, so default sizes stay where a run takes minutes */
+    if ( options.sizes.empty() )
+        options.sizes = { 3, 10, 30, 60 };
+
+    return true;
+}
+
+int main( int argc, char** argv)
+{
+    Options options;
+    std::vector<Result> results;
+    std::unique_ptr<Executor> executor;
+
+    if ( !ParseOptions( argc, argv, options) )
+    {
+        std::cerr << "Usage: " << argv[ 0] << " [--sizes 3,10,30] [--reps R] [--warmup W]"
+                  << " [--time-limit seconds] [--threads T] [--csv path] [--json path]\n";
+        return 1;
+    }
+
+    if ( options.threads > 1 )
+        executor.reset( new Executor( options.threads));
+
+    for ( unsigned distribution = 0; distribution < Distributions; ++distribution)
+    {
+        for ( auto it = options.sizes.begin();
+              it != options.sizes.end();
+              ++it)
+        {
+            results.push_back( RunCase( options, static_cast<Distribution>( distribution), *it, executor.get()));
+            std::cerr << distribution_names[ distribution] << " " << *it << " pins done\n";
+        }
+    }
+
+    if ( options.csv_path )
+    {
+        std::ofstream output( options.csv_path);
+        WriteCSV( output, results);
+    }
+
+    if ( options.json_path )
+    {
+        std::ofstream output( options.json_path);
+        WriteJSON( output, results);
+    }
+
+    if ( !options.csv_path
+         && !options.json_path )
+        WriteCSV( std::cout, results);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "../solution_writer.h"
+#include <stdlib.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ *  Bulk throughput benchmark for solution output
+ *
+ *  Usage: writer_bench.out [output_path] [segments_count]
+ *
+ *  Writes the same set of segment lines with std::ofstream
+ *  and with SolutionWriter and reports MB/s for both
+ */
+
+struct Segment
+{
+    unsigned x1;
+    unsigned y1;
+    unsigned x2;
+    unsigned y2;
+};
+
+static double MegabytesPerSecond( std::size_t bytes, double seconds)
+{
+    return seconds > 0 ? bytes / ( 1024.0 * 1024.0) / seconds : 0;
+}
+
+static void WriteByStream( const char* path, const std::vector<Segment>& segments)
+{
+    std::ofstream output( path);
+
+    for ( auto it = segments.begin();
+          it != segments.end();
+          ++it)
+    {
+        output << "    <segment x1=\"" << it->x1 << "\" y1=\"" << it->y1 << "\" x2=\"" << it->x2 << "\" y2=\"" << it->y2 << "\" layer=" << "\"m2\"" << " />\n";
+    }
+}
+
+static std::size_t WriteByWriter( const char* path, const std::vector<Segment>& segments)
+{
+    SolutionWriter output;
+    std::size_t bytes = 0;
+
+    output.Open( path);
+
+    for ( auto it = segments.begin();
+          it != segments.end();
+          ++it)
+    {
+        output.Append( "    <segment x1=\"");
+        output.AppendUnsigned( it->x1);
+        output.Append( "\" y1=\"");
+        output.AppendUnsigned( it->y1);
+        output.Append( "\" x2=\"");
+        output.AppendUnsigned( it->x2);
+        output.Append( "\" y2=\"");
+        output.AppendUnsigned( it->y2);
+        output.Append( "\" layer=");
+        output.Append( "\"m2\"");
+        output.Append( " />\n");
+    }
+
+    bytes = output.GetWrittenBytes();
+    output.Close();
+
+    return bytes;
+}
+
+int main( int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[ 1] : "/dev/null";
+    std::size_t count = argc > 2 ? atol( argv[ 2]) : 5000000;
+
+    std::mt19937 gen( 1);
+    std::uniform_int_distribution<unsigned> coord( 0, 1000000);
+    std::vector<Segment> segments( count);
+
+    for ( auto it = segments.begin();
+          it != segments.end();
+          ++it)
+    {
+        it->x1 = coord( gen);
+        it->y1 = coord( gen);
+        it->x2 = coord( gen);
+        it->y2 = it->y1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    WriteByStream( path, segments);
+    auto stop = std::chrono::steady_clock::now();
+    double stream_time = std::chrono::duration<double>( stop - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::size_t bytes = WriteByWriter( path, segments);
+    stop = std::chrono::steady_clock::now();
+    double writer_time = std::chrono::duration<double>( stop - start).count();
+
+    std::cout << "segments: " << count << ", bytes: " << bytes << "\n";
+    std::cout << "std::ofstream:  " << stream_time << " s, " << MegabytesPerSecond( bytes, stream_time) << " MB/s\n";
+    std::cout << "SolutionWriter: " << writer_time << " s, " << MegabytesPerSecond( bytes, writer_time) << " MB/s\n";
+
+    return 0;
+}
@@ -1,4 +1,16 @@
-g++ -O4 -c smt.cc -o smt.o -std=c++11
-g++ -O4 -c main.cc -o main.o -std=c++11
-g++ -O4 main.o smt.o -o main.out -std=c++11
+g++ -O4 -c smt.cc -o smt.o -std=c++11 -pthread -DSMT_STATS
+g++ -O4 -c executor.cc -o executor.o -std=c++11 -pthread
+g++ -O4 -c tracer.cc -o tracer.o -std=c++11 -pthread
+g++ -O4 -c perf_counters.cc -o perf_counters.o -std=c++11
+g++ -O4 -c solution_writer.cc -o solution_writer.o -std=c++11
+g++ -O4 -c pin_parser.cc -o pin_parser.o -std=c++11
+g++ -O4 -c smt_cache.cc -o smt_cache.o -std=c++11 -pthread
+g++ -O4 -c disk_cache.cc -o disk_cache.o -std=c++11
+g++ -O4 -c solution_checker.cc -o solution_checker.o -std=c++11
+g++ -O4 -c main.cc -o main.o -std=c++11 -pthread
+g++ -O4 main.o smt.o executor.o tracer.o perf_counters.o smt_cache.o solution_writer.o pin_parser.o disk_cache.o solution_checker.o -o main.out -std=c++11 -pthread
+g++ -O4 bench/writer_bench.cc solution_writer.o -o writer_bench.out -std=c++11
+g++ -O4 bench/smt_bench.cc smt.o executor.o tracer.o perf_counters.o -o smt_bench.out -std=c++11 -pthread
+g++ -O4 bench/quality_bench.cc smt.o executor.o tracer.o perf_counters.o -o quality_bench.out -std=c++11 -pthread
+g++ -O4 bench/scaling_bench.cc smt.o executor.o tracer.o perf_counters.o -o scaling_bench.out -std=c++11 -pthread
 rm *.o
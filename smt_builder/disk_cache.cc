@@ -0,0 +1,205 @@
+#include "disk_cache.h"
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ *  Record is a header, key and value, padded to 8 bytes.
+ *  Numbers are stored in the native byte order
+ */
+struct RecordHeader
+{
+    uint32_t magic;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint32_t checksum;
+    uint64_t key_hash;
+};
+
+static const uint32_t record_magic = 0x31544d53; // "SMT1"
+
+static std::size_t RecordSize( const RecordHeader& header)
+{
+    std::size_t size = sizeof( RecordHeader) + header.key_size + header.value_size;
+    return ( size + 7) & ~static_cast<std::size_t>( 7);
+}
+
+/** Offset of the first record magic from the given one or the end of data */
+static std::size_t FindMagic( const char* data, std::size_t size, std::size_t offset)
+{
+    for ( ; offset + sizeof( record_magic) <= size; ++offset)
+    {
+        if ( !std::memcmp( data + offset, &record_magic, sizeof( record_magic)) )
+            return offset;
+    }
+
+    return size;
+}
+
+static uint32_t Checksum( const char* key, std::size_t key_size, const char* value, std::size_t value_size)
+{
+    unsigned long long hash = DiskCache::Hash( key, key_size) ^ DiskCache::Hash( value, value_size);
+    return static_cast<uint32_t>( hash ^ ( hash >> 32));
+}
+
+unsigned long long DiskCache::Hash( const char* data, std::size_t size)
+{
+    /** FNV-1a */
+    unsigned long long hash = 14695981039346656037ull;
+
+    for ( std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>( data[ i]);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+DiskCache::DiskCache()
+{
+    this->fd = -1;
+    this->data = nullptr;
+    this->size = 0;
+}
+
+DiskCache::~DiskCache()
+{
+    this->Close();
+}
+
+void DiskCache::Unmap()
+{
+    if ( this->data )
+        munmap( const_cast<char*>( this->data), this->size);
+
+    this->data = nullptr;
+    this->size = 0;
+    this->index.clear();
+}
+
+void DiskCache::BuildIndex()
+{
+    std::size_t offset = 0;
+
+    while ( offset + sizeof( RecordHeader) <= this->size )
+    {
+        RecordHeader header;
+        std::memcpy( &header, this->data + offset, sizeof( header));
+
+        const char* record_key = this->data + offset + sizeof( RecordHeader);
+
+        if ( header.magic != record_magic
+             || RecordSize( header) > this->size - offset
+             || header.checksum != Checksum( record_key, header.key_size,
+                                             record_key + header.key_size, header.value_size) )
+        {
+            /** Torn record, the next one starts right after it at any alignment */
+            offset = FindMagic( this->data, this->size, offset + 1);
+            continue;
+        }
+
+        this->index.insert( std::make_pair( header.key_hash, offset));
+        offset += RecordSize( header);
+    }
+}
+
+bool DiskCache::Open( const char* path)
+{
+    struct stat info;
+
+    this->Close();
+
+    this->fd = open( path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if ( this->fd < 0 )
+        return false;
+
+    if ( fstat( this->fd, &info)
+         || info.st_size <= 0 )
+        return true;
+
+    void* mapped = mmap( nullptr, info.st_size, PROT_READ, MAP_SHARED, this->fd, 0);
+    if ( mapped == MAP_FAILED )
+        return true;
+
+    this->data = static_cast<const char*>( mapped);
+    this->size = info.st_size;
+    this->BuildIndex();
+
+    return true;
+}
+
+void DiskCache::Close()
+{
+    this->Unmap();
+
+    if ( this->fd >= 0 )
+        close( this->fd);
+
+    this->fd = -1;
+}
+
+bool DiskCache::Find( const std::string& key, std::string& value)
+{
+    auto range = this->index.equal_range( Hash( key.data(), key.size()));
+
+    std::size_t found = this->size;
+
+    /** Records in the index are already checked, the latest one of the key wins */
+    for ( auto it = range.first;
+          it != range.second;
+          ++it)
+    {
+        RecordHeader header;
+        std::memcpy( &header, this->data + it->second, sizeof( header));
+
+        const char* record_key = this->data + it->second + sizeof( RecordHeader);
+
+        if ( header.key_size == key.size()
+             && !std::memcmp( record_key, key.data(), key.size())
+             && ( found == this->size || it->second > found ) )
+            found = it->second;
+    }
+
+    if ( found == this->size )
+        return false;
+
+    RecordHeader header;
+    std::memcpy( &header, this->data + found, sizeof( header));
+
+    value.assign( this->data + found + sizeof( RecordHeader) + header.key_size, header.value_size);
+
+    return true;
+}
+
+bool DiskCache::Append( const std::string& key, const std::string& value)
+{
+    if ( this->fd < 0 )
+        return false;
+
+    RecordHeader header;
+    header.magic = record_magic;
+    header.key_size = key.size();
+    header.value_size = value.size();
+    header.checksum = Checksum( key.data(), key.size(), value.data(), value.size());
+    header.key_hash = Hash( key.data(), key.size());
+
+    /** Whole record goes with one write, so readers never see it half-done */
+    std::string record( RecordSize( header), '\0');
+    std::memcpy( &record[ 0], &header, sizeof( header));
+    std::memcpy( &record[ sizeof( header)], key.data(), key.size());
+    std::memcpy( &record[ sizeof( header) + key.size()], value.data(), value.size());
+
+    if ( flock( this->fd, LOCK_EX) )
+        return false;
+
+    ssize_t written = write( this->fd, record.data(), record.size());
+
+    flock( this->fd, LOCK_UN);
+
+    return written == static_cast<ssize_t>( record.size());
+}
@@ -0,0 +1,54 @@
+#ifndef SMT__DISK_CACHE_H
+#define SMT__DISK_CACHE_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+/**
+ *  Description for disk cache
+ *
+ *  Disk cache is a single append-only file of records, every record
+ *  keeps a key (net contents and solver version), a value (solution)
+ *  and a checksum. File is read through mmap, new records are added
+ *  with one write under an exclusive flock, so parallel builder
+ *  processes can share the file. Records appended after the file was
+ *  opened are not seen by this process.
+ *
+ *  Open indexes records by key hash once. A torn record, left by a
+ *  short write or a crash, is skipped up to the next record magic, so
+ *  records appended after it are still found. When a key has several
+ *  records, the latest one is found
+ */
+class DiskCache
+{
+
+private:
+
+    int fd;
+    const char* data;
+    std::size_t size;
+
+    /** Offsets of valid records by key hash */
+    std::unordered_multimap<unsigned long long, std::size_t> index;
+
+    void Unmap();
+    void BuildIndex();
+
+public:
+
+    DiskCache();
+    ~DiskCache();
+    DiskCache( const DiskCache& other) = delete;
+    DiskCache& operator=( const DiskCache& other) = delete;
+
+    bool Open( const char* path);
+    void Close();
+
+    bool Find( const std::string& key, std::string& value);
+    bool Append( const std::string& key, const std::string& value);
+
+    static unsigned long long Hash( const char* data, std::size_t size);
+};
+
+#endif
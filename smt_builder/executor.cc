@@ -0,0 +1,198 @@
+#include "executor.h"
+#include <chrono>
+#include <iterator>
+#include <utility>
+
+/** Pool and index of the current thread, if it is a pool thread */
+static thread_local Executor* current_executor = nullptr;
+static thread_local unsigned current_index = 0;
+
+Executor::Executor( unsigned threads_count)
+{
+    if ( !threads_count )
+        threads_count = std::thread::hardware_concurrency();
+
+    if ( !threads_count )
+        threads_count = 1;
+
+    this->pending = 0;
+    this->next_worker = 0;
+    this->is_stopped = false;
+
+    for ( unsigned i = 0; i < threads_count; ++i)
+    {
+        this->workers.push_back( std::unique_ptr<Worker>( new Worker));
+    }
+
+    for ( unsigned i = 0; i < threads_count; ++i)
+    {
+        this->threads.push_back( std::thread( &Executor::WorkerLoop, this, i));
+    }
+}
+
+Executor::~Executor()
+{
+    {
+        std::lock_guard<std::mutex> guard( this->sleep_lock);
+        this->is_stopped = true;
+    }
+
+    this->wake.notify_all();
+
+    for ( auto it = this->threads.begin();
+          it != this->threads.end();
+          ++it)
+    {
+        it->join();
+    }
+}
+
+Executor& Executor::GetInstance()
+{
+    static Executor instance;
+    return instance;
+}
+
+int Executor::GetCurrentWorker()
+{
+    return current_executor == this ? static_cast<int>( current_index) : -1;
+}
+
+void Executor::Submit( Task task, const Group* group)
+{
+    int index = this->GetCurrentWorker();
+
+    if ( index < 0 )
+        index = this->next_worker++ % this->workers.size();
+
+    {
+        /**
+         *  Task is counted before it is published, so a thief can't take
+         *  pending below zero. Taking the lock makes sure a thread going
+         *  to sleep sees the task
+         */
+        std::lock_guard<std::mutex> guard( this->sleep_lock);
+        this->pending++;
+    }
+
+    {
+        Worker& worker = *this->workers[ index];
+        std::lock_guard<std::mutex> guard( worker.lock);
+        worker.tasks.push_back( Job{ std::move( task), group });
+    }
+
+    this->wake.notify_one();
+}
+
+namespace
+{
+
+/** First job of the group between begin and end, any job if group is nullptr */
+template<typename Iterator> Iterator FindJob( Iterator begin, Iterator end, const Executor::Group* group)
+{
+    for ( Iterator it = begin;
+          it != end;
+          ++it)
+    {
+        if ( !group
+             || it->group == group )
+            return it;
+    }
+
+    return end;
+}
+
+}
+
+bool Executor::TakeTask( int index, Task& task, const Group* group)
+{
+    unsigned count = this->workers.size();
+
+    /** Own tasks are taken from the back, they are the most recent ones */
+    if ( index >= 0 )
+    {
+        Worker& worker = *this->workers[ index];
+        std::lock_guard<std::mutex> guard( worker.lock);
+
+        auto found = FindJob( worker.tasks.rbegin(), worker.tasks.rend(), group);
+
+        if ( found != worker.tasks.rend() )
+        {
+            task = std::move( found->task);
+            worker.tasks.erase( std::next( found).base());
+            this->pending--;
+            return true;
+        }
+    }
+
+    unsigned start = index >= 0 ? index + 1 : this->next_worker.load();
+
+    for ( unsigned i = 0; i < count; ++i)
+    {
+        Worker& victim = *this->workers[ ( start + i) % count];
+        std::lock_guard<std::mutex> guard( victim.lock);
+
+        auto found = FindJob( victim.tasks.begin(), victim.tasks.end(), group);
+
+        if ( found != victim.tasks.end() )
+        {
+            task = std::move( found->task);
+            victim.tasks.erase( found);
+            this->pending--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Executor::RunPendingTask( const Group* group)
+{
+    Task task;
+
+    if ( !this->TakeTask( this->GetCurrentWorker(), task, group) )
+        return false;
+
+    task();
+
+    return true;
+}
+
+void Executor::WaitFor( Group& counter)
+{
+    while ( counter.load() )
+    {
+        if ( !this->RunPendingTask( &counter) )
+            std::this_thread::yield();
+    }
+}
+
+void Executor::WorkerLoop( unsigned index)
+{
+    current_executor = this;
+    current_index = index;
+
+    while ( true )
+    {
+        Task task;
+
+        if ( this->TakeTask( index, task, nullptr) )
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard( this->sleep_lock);
+
+        if ( this->is_stopped )
+            break;
+
+        this->wake.wait_for( guard, std::chrono::milliseconds( 10),
+                             [ this]() { return this->pending.load() || this->is_stopped.load(); });
+    }
+}
+
+unsigned Executor::GetThreadsCount()
+{
+    return this->threads.size();
+}
@@ -0,0 +1,82 @@
+#ifndef SMT__EXECUTOR_H
+#define SMT__EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  Description for executor
+ *
+ *  Executor is a pool of threads with a task deque per thread.
+ *  A thread takes its own newest tasks first and steals the oldest
+ *  tasks of other threads when it has nothing to do. Tasks submitted
+ *  from a pool thread go to its own deque, so subtasks of a big net
+ *  stay close to it, while other threads pick up whole nets.
+ *
+ *  Subtasks are submitted with the counter of their group. A thread
+ *  which waits for the group runs its pending tasks meanwhile, so
+ *  nested waiting doesn't block the pool and a net doesn't wait behind
+ *  unrelated ones
+ */
+class Executor
+{
+
+public:
+
+    typedef std::function<void()> Task;
+    typedef std::atomic<unsigned> Group;
+
+private:
+
+    struct Job
+    {
+        Task task;
+
+        /** Group the task belongs to, if any */
+        const Group* group;
+    };
+
+    struct Worker
+    {
+        std::mutex lock;
+        std::deque<Job> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker> > workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<unsigned> pending;
+    std::atomic<unsigned> next_worker;
+    std::atomic<bool> is_stopped;
+
+    int GetCurrentWorker();
+    bool TakeTask( int index, Task& task, const Group* group);
+    void WorkerLoop( unsigned index);
+
+public:
+
+    Executor( unsigned threads_count = 0);
+    ~Executor();
+    Executor( const Executor& other) = delete;
+    Executor& operator=( const Executor& other) = delete;
+
+    static Executor& GetInstance();
+
+    void Submit( Task task, const Group* group = nullptr);
+    bool RunPendingTask( const Group* group = nullptr);
+
+    /** Runs pending tasks of the group until the counter drops to zero */
+    void WaitFor( Group& counter);
+
+    unsigned GetThreadsCount();
+};
+
+#endif
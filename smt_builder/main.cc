@@ -1,44 +1,80 @@
 #include "smt.h"
+#include "solution_writer.h"
+#include "pin_parser.h"
+#include "disk_cache.h"
+#include "smt_cache.h"
+#include "solution_checker.h"
+#include "tracer.h"
+#include "perf_counters.h"
 #include "rapidxml/rapidxml.hpp"
 #include <stdlib.h>
+#include <unistd.h>
 #include <string.h>
+#include <limits.h>
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <string>
 #include <vector>
 
+/** Max coordinate SMT can hold in this build */
+static const unsigned long long max_coord = std::numeric_limits<SMT::Coord>::max();
+
 enum RetVal
 {
     Success = 0,
     WrongArgNum,
-    BadBench
+    BadBench,
+    BadOutput,
+    BadSeeds,
+    BadSolution
 };
 
-int main( int argc, char** argv)
+/**
+ *  Generic path for benches which pin parser doesn't recognize
+ */
+static RetVal ParseGenericBench( char* text,
+                                 unsigned long long& width,
+                                 unsigned long long& height,
+                                 unsigned long long& pin_count,
+                                 std::vector<PinParser::Pin>& pins)
 {
-    if ( argc != 3 )
-        return WrongArgNum;
-
-    std::ifstream input( argv[ 1]);
-
-    std::vector<char> buffer( ( std::istreambuf_iterator<char>( input)),
-                                std::istreambuf_iterator<char>());
-    buffer.push_back( '\0');
-    input.close();
-
     rapidxml::xml_document<> bench;
     rapidxml::xml_node<>* net;
 
-    bench.parse<0>( &buffer[ 0]);
-    buffer.clear();
+    try
+    {
+        bench.parse<0>( text);
+    }
+    catch ( rapidxml::parse_error& )
+    {
+        return BadBench;
+    }
 
     net = bench.first_node();
 
-    if ( strcmp( net->name(), "net") )
+    if ( !net
+         || strcmp( net->name(), "net") )
         return BadBench;
 
-    unsigned grid_size = atoi( net->first_attribute( "grid_size")->value());
-    unsigned pin_count = atoi( net->first_attribute( "pin_count")->value());
+    /** Grid is either a square with grid_size or a rectangle with width and height */
+    rapidxml::xml_attribute<>* grid_size_attr = net->first_attribute( "grid_size");
+    rapidxml::xml_attribute<>* width_attr = grid_size_attr ? grid_size_attr : net->first_attribute( "width");
+    rapidxml::xml_attribute<>* height_attr = grid_size_attr ? grid_size_attr : net->first_attribute( "height");
+    rapidxml::xml_attribute<>* pin_count_attr = net->first_attribute( "pin_count");
 
-    SMT smt( grid_size, pin_count);
+    if ( !width_attr
+         || !height_attr
+         || !pin_count_attr
+         || PinParser::ParseDecimal( width_attr->value(), ULLONG_MAX, width) != PinParser::Parsed
+         || PinParser::ParseDecimal( height_attr->value(), ULLONG_MAX, height) != PinParser::Parsed
+         || PinParser::ParseDecimal( pin_count_attr->value(), UINT_MAX, pin_count) != PinParser::Parsed
+         || !width
+         || !height )
+        return BadBench;
+
+    unsigned long long max_x = std::min<unsigned long long>( width - 1, max_coord);
+    unsigned long long max_y = std::min<unsigned long long>( height - 1, max_coord);
 
     for ( rapidxml::xml_node<>* point = net->first_node();
           point;
@@ -47,36 +83,442 @@ int main( int argc, char** argv)
         if ( strcmp( point->name(), "point") )
             return BadBench;
 
-        const char* type = point->first_attribute( "type")->value();
-        if ( strcmp( type, "pin") )
+        rapidxml::xml_attribute<>* type = point->first_attribute( "type");
+        if ( !type
+             || strcmp( type->value(), "pin") )
             return BadBench;
 
-        const char* x = point->first_attribute( "x")->value();
-        if ( !x )
+        rapidxml::xml_attribute<>* x = point->first_attribute( "x");
+        rapidxml::xml_attribute<>* y = point->first_attribute( "y");
+        PinParser::Pin pin;
+
+        if ( !x
+             || !y
+             || PinParser::ParseDecimal( x->value(), max_x, pin.x) != PinParser::Parsed
+             || PinParser::ParseDecimal( y->value(), max_y, pin.y) != PinParser::Parsed )
             return BadBench;
 
-        const char* y = point->first_attribute( "y")->value();
-        if ( !y )
+        pins.push_back( pin);
+    }
+
+    return Success;
+}
+
+/**
+ *  Seeds SMT with Steiner points of a previous solution, so the
+ *  rerun starts from it. Only m2_m3 vias can be Steiner points,
+ *  the rest of them are pruned by BuildSMT
+ */
+static RetVal ReadSeeds( const char* path, SMT& smt)
+{
+    std::ifstream input( path);
+
+    if ( !input )
+        return BadSeeds;
+
+    std::vector<char> buffer( ( std::istreambuf_iterator<char>( input)),
+                                std::istreambuf_iterator<char>());
+    buffer.push_back( '\0');
+    input.close();
+
+    rapidxml::xml_document<> solution;
+    rapidxml::xml_node<>* net;
+
+    try
+    {
+        solution.parse<0>( &buffer[ 0]);
+    }
+    catch ( rapidxml::parse_error& )
+    {
+        return BadSeeds;
+    }
+
+    net = solution.first_node();
+
+    if ( !net
+         || strcmp( net->name(), "net") )
+        return BadSeeds;
+
+    for ( rapidxml::xml_node<>* point = net->first_node( "point");
+          point;
+          point = point->next_sibling( "point"))
+    {
+        rapidxml::xml_attribute<>* layer = point->first_attribute( "layer");
+        rapidxml::xml_attribute<>* x = point->first_attribute( "x");
+        rapidxml::xml_attribute<>* y = point->first_attribute( "y");
+        unsigned long long pos_x;
+        unsigned long long pos_y;
+
+        if ( !layer
+             || strcmp( layer->value(), "m2_m3") )
+            continue;
+
+        if ( !x
+             || !y
+             || PinParser::ParseDecimal( x->value(), ULLONG_MAX, pos_x) != PinParser::Parsed
+             || PinParser::ParseDecimal( y->value(), ULLONG_MAX, pos_y) != PinParser::Parsed )
+            return BadSeeds;
+
+        if ( pos_x > max_coord
+             || pos_y > max_coord )
+            continue;
+
+        /** Seeds out of grid or on top of other points are just skipped */
+        smt.AddSteinerPoint( pos_x, pos_y);
+    }
+
+    return Success;
+}
+
+/**
+ *  Solver version for the disk cache key, it has to be changed
+ *  every time the solution for the same net may change
+ */
+static const char solver_version[] = "smt_builder-5";
+
+/** Writes counters of one phase as a JSON member */
+static void DumpCounters( std::ostream& output, const char* phase, const PerfCounters::Values& counters)
+{
+    output << "\"" << phase << "\": {\"cycles\": " << counters.cycles
+           << ", \"instructions\": " << counters.instructions
+           << ", \"ipc\": " << ( counters.cycles ? static_cast<double>( counters.instructions) / counters.cycles : 0 )
+           << ", \"cache_misses\": " << counters.cache_misses
+           << ", \"branch_misses\": " << counters.branch_misses
+           << "}";
+}
+
+/**
+ *  Appends stats of the build as one JSON line, so batch runs can
+ *  collect lines of all nets in one file
+ */
+static void DumpStats( const char* path, const char* bench, const SMT& smt, SMT::Length length, SMTCache* pattern_cache)
+{
+    std::ofstream output( path, std::ios::app);
+    const SMT::Stats& stats = smt.GetStats();
+
+    output << "{\"bench\": \"";
+
+    for ( const char* c = bench; *c; ++c)
+    {
+        if ( *c == '"' || *c == '\\' )
+            output << '\\';
+
+        output << *c;
+    }
+
+    output << "\", \"pins\": " << smt.GetPinCount()
+           << ", \"length\": " << length
+           << ", \"converged\": " << ( smt.IsConverged() ? "true" : "false" )
+           << ", \"time\": {\"hanan\": " << stats.hanan_time
+           << ", \"mst\": " << stats.mst_time
+           << ", \"iterations\": " << stats.iterations_time
+           << ", \"finalize\": " << stats.finalize_time
+           << "}, \"rounds\": " << stats.rounds
+           << ", \"evaluations\": " << stats.evaluations
+           << ", \"edges_inserted\": " << stats.edges_inserted
+           << ", \"edges_scanned\": " << stats.edges_scanned
+           << ", \"allocations\": " << stats.allocations
+           << ", \"pattern_cache\": ";
+
+    if ( pattern_cache )
+    {
+        output << "{\"hits\": " << pattern_cache->GetHits()
+               << ", \"misses\": " << pattern_cache->GetMisses() << "}";
+    }
+    else
+        output << "null";
+
+    output << ", \"counters\": ";
+
+    /** Phases are counted together, so one of them tells if counters worked */
+    if ( !stats.mst_counters.is_counted )
+    {
+        output << "null}\n";
+        return;
+    }
+
+    output << "{";
+    DumpCounters( output, "hanan", stats.hanan_counters);
+    output << ", ";
+    DumpCounters( output, "mst", stats.mst_counters);
+    output << ", ";
+    DumpCounters( output, "iterations", stats.iterations_counters);
+    output << ", ";
+    DumpCounters( output, "finalize", stats.finalize_counters);
+    output << "}}\n";
+}
+
+/**
+ *  Cached solution is read back and checked against pins of the bench,
+ *  so a stale or damaged record is rebuilt instead of being written
+ */
+static bool IsValidCachedSolution( const std::string& solution, const std::vector<PinParser::Pin>& pins)
+{
+    std::vector<char> buffer( solution.begin(), solution.end());
+    buffer.push_back( '\0');
+
+    rapidxml::xml_document<> document;
+    rapidxml::xml_node<>* net;
+    SolutionChecker checker;
+
+    try
+    {
+        document.parse<0>( &buffer[ 0]);
+    }
+    catch ( rapidxml::parse_error& )
+    {
+        return false;
+    }
+
+    net = document.first_node();
+
+    if ( !net
+         || strcmp( net->name(), "net") )
+        return false;
+
+    for ( rapidxml::xml_node<>* node = net->first_node();
+          node;
+          node = node->next_sibling())
+    {
+        bool is_segment = !strcmp( node->name(), "segment");
+        rapidxml::xml_attribute<>* layer = node->first_attribute( "layer");
+        rapidxml::xml_attribute<>* x1 = node->first_attribute( is_segment ? "x1" : "x");
+        rapidxml::xml_attribute<>* y1 = node->first_attribute( is_segment ? "y1" : "y");
+        rapidxml::xml_attribute<>* x2 = is_segment ? node->first_attribute( "x2") : x1;
+        rapidxml::xml_attribute<>* y2 = is_segment ? node->first_attribute( "y2") : y1;
+        unsigned long long pos_x1, pos_y1, pos_x2, pos_y2;
+
+        if ( ( !is_segment && strcmp( node->name(), "point") )
+             || !layer
+             || !x1
+             || !y1
+             || !x2
+             || !y2
+             || PinParser::ParseDecimal( x1->value(), max_coord, pos_x1) != PinParser::Parsed
+             || PinParser::ParseDecimal( y1->value(), max_coord, pos_y1) != PinParser::Parsed
+             || PinParser::ParseDecimal( x2->value(), max_coord, pos_x2) != PinParser::Parsed
+             || PinParser::ParseDecimal( y2->value(), max_coord, pos_y2) != PinParser::Parsed )
+            return false;
+
+        if ( is_segment )
+        {
+            /** Segments out of M2 and M3 are bad ones, checker sees them on the pins layer */
+            SolutionChecker::Layer segment_layer = !strcmp( layer->value(), "m2") ? SolutionChecker::M2 :
+                                                   !strcmp( layer->value(), "m3") ? SolutionChecker::M3 :
+                                                                                    SolutionChecker::Pins;
+
+            checker.AddSegment( pos_x1, pos_y1, pos_x2, pos_y2, segment_layer);
+        }
+        else if ( !strcmp( layer->value(), "pins_m2") )
+        {
+            checker.AddVia( pos_x1, pos_y1, SolutionChecker::Pins);
+        }
+        else if ( !strcmp( layer->value(), "m2_m3") )
+        {
+            checker.AddVia( pos_x1, pos_y1, SolutionChecker::M2);
+        }
+    }
+
+    /** Pins come from the bench, so a solution missing some of them is disconnected */
+    for ( auto it = pins.begin();
+          it != pins.end();
+          ++it)
+    {
+        checker.AddPin( it->x, it->y);
+    }
+
+    return checker.Check( SMT::no_length) == SolutionChecker::Valid;
+}
+
+/**
+ *  Key for the disk cache: solver version and parsed net contents,
+ *  so formatting of the bench doesn't matter
+ */
+static std::string MakeCacheKey( unsigned long long width,
+                                 unsigned long long height,
+                                 unsigned long long pin_count,
+                                 const std::vector<PinParser::Pin>& pins)
+{
+    std::string key( solver_version, sizeof( solver_version));
+
+    key.append( reinterpret_cast<const char*>( &width), sizeof( width));
+    key.append( reinterpret_cast<const char*>( &height), sizeof( height));
+    key.append( reinterpret_cast<const char*>( &pin_count), sizeof( pin_count));
+
+    for ( auto it = pins.begin();
+          it != pins.end();
+          ++it)
+    {
+        key.append( reinterpret_cast<const char*>( &it->x), sizeof( it->x));
+        key.append( reinterpret_cast<const char*>( &it->y), sizeof( it->y));
+    }
+
+    return key;
+}
+
+/**
+ *  Usage: main.out bench.xml solution.xml [seed_solution.xml]
+ *
+ *  If SMT_CACHE environment variable is set, it is a path to the disk
+ *  cache file, which is used for runs without seeds. If SMT_PATTERN_CACHE
+ *  is set, runs without seeds look up Steiner points of nets with the
+ *  same pin pattern, they are kept in the disk cache when it is used
+ */
+int main( int argc, char** argv)
+{
+    if ( argc != 3
+         && argc != 4 )
+        return WrongArgNum;
+
+    std::ifstream input( argv[ 1]);
+
+    std::vector<char> buffer( ( std::istreambuf_iterator<char>( input)),
+                                std::istreambuf_iterator<char>());
+    buffer.push_back( '\0');
+    input.close();
+
+    unsigned long long width;
+    unsigned long long height;
+    unsigned long long pin_count;
+    std::vector<PinParser::Pin> pins;
+
+    PinParser parser( &buffer[ 0], buffer.size(), max_coord);
+
+    switch ( parser.Parse() )
+    {
+        case PinParser::Parsed:
+            width = height = parser.GetGridSize();
+            pin_count = parser.GetPinCount();
+            pins.swap( parser.GetPins());
+            break;
+        case PinParser::OutOfRange:
             return BadBench;
+        default:
+        {
+            RetVal res = ParseGenericBench( &buffer[ 0], width, height, pin_count, pins);
+            if ( res != Success )
+                return res;
+            break;
+        }
+    }
+
+    DiskCache cache;
+    std::string cache_key;
+    std::string cached_solution;
+    const char* cache_path = getenv( "SMT_CACHE");
+    bool is_cached = argc == 3 && cache_path && cache.Open( cache_path);
+
+    if ( is_cached )
+    {
+        cache_key = MakeCacheKey( width, height, pin_count, pins);
+
+        if ( cache.Find( cache_key, cached_solution)
+             && IsValidCachedSolution( cached_solution, pins) )
+        {
+            SolutionWriter output;
+
+            if ( !output.Open( argv[ 2]) )
+                return BadOutput;
 
-        smt.AddPin( atoi( x), atoi( y));
+            output.Append( cached_solution.data(), cached_solution.size());
+
+            return output.Close() ? Success : BadOutput;
+        }
+
+        /** Captured solution replaces a bad record */
+        cached_solution.clear();
     }
 
-    smt.BuildSMT();
+    const char* trace_path = getenv( "SMT_TRACE_FILE");
+    if ( trace_path )
+        Tracer::GetInstance().Enable();
+
+    /** Without counters in the system stats keep timing only */
+    if ( getenv( "SMT_PERF_COUNTERS") )
+        PerfCounters::GetInstance().Enable();
+
+    /** Pins are already checked against max_coord, so grid can be clamped to it */
+    SMT smt( std::min( width, max_coord), std::min( height, max_coord), pin_count);
 
-    std::list<SMT::Point> sol_points = smt.GetPointsList();
-    std::list<SMT::Edge> sol_edges = smt.GetEdgesList();
+    for ( auto it = pins.begin();
+          it != pins.end();
+          ++it)
+    {
+        smt.AddPin( it->x, it->y);
+    }
 
-    std::ofstream output( argv[ 2]);
+    if ( argc == 4 )
+    {
+        RetVal res = ReadSeeds( argv[ 3], smt);
+        if ( res != Success )
+            return res;
+    }
 
-    output << "<net grid_size=\"" << grid_size << "\" pin_count=\"" << pin_count << "\">" << std::endl;
+    /**
+     *  Pattern cache shares Steiner points of nets with the same pins up
+     *  to translation, mirroring and rotation. Seeds change the result,
+     *  so seeded builds don't use it
+     */
+    SMTCache* pattern_cache = nullptr;
+
+    if ( argc == 3
+         && getenv( "SMT_PATTERN_CACHE") )
+    {
+        pattern_cache = &SMTCache::GetInstance();
+
+        if ( is_cached )
+            pattern_cache->SetDiskCache( &cache, std::string( "pattern:") + solver_version);
+    }
+
+    SMT::Length length = pattern_cache ? pattern_cache->BuildSMT( smt) : smt.BuildSMT();
+
+    /** Checker is cheap, so every solution is checked before it is written, disk cache hits too */
+    if ( SolutionChecker( smt).Check( length) != SolutionChecker::Valid )
+        return BadSolution;
+
+    const char* stats_path = getenv( "SMT_STATS_FILE");
+    if ( stats_path )
+        DumpStats( stats_path, argv[ 1], smt, length, pattern_cache);
+
+    /** Process id keeps traces of parallel runs apart when they are merged */
+    if ( trace_path
+         && !Tracer::GetInstance().Write( trace_path, getpid()) )
+        return BadOutput;
+
+    SMT::PointsView sol_points = smt.GetPoints();
+    SMT::EdgesView sol_edges = smt.GetEdges();
+
+    SolutionWriter output;
+
+    if ( !output.Open( argv[ 2]) )
+        return BadOutput;
+
+    if ( is_cached )
+        output.SetCapture( &cached_solution);
+
+    if ( width == height )
+    {
+        output.Append( "<net grid_size=\"");
+        output.AppendUnsigned( width);
+    }
+    else
+    {
+        output.Append( "<net width=\"");
+        output.AppendUnsigned( width);
+        output.Append( "\" height=\"");
+        output.AppendUnsigned( height);
+    }
+
+    output.Append( "\" pin_count=\"");
+    output.AppendUnsigned( pin_count);
+    output.Append( "\">\n");
 
     for ( auto it = sol_points.begin();
           it != sol_points.end();
           ++it)
     {
-        unsigned x = ( *it).GetPosX();
-        unsigned y = ( *it).GetPosY();
+        SMT::Coord x = ( *it).GetPosX();
+        SMT::Coord y = ( *it).GetPosY();
 
         const char* layer;
         const char* type;
@@ -101,26 +543,50 @@ int main( int argc, char** argv)
                 break;
         }
 
-        output << "    <point x=\"" << x << "\" y=\"" << y << "\" layer=" << layer << " type=" << type << " />\n";
+        output.Append( "    <point x=\"");
+        output.AppendUnsigned( x);
+        output.Append( "\" y=\"");
+        output.AppendUnsigned( y);
+        output.Append( "\" layer=");
+        output.Append( layer);
+        output.Append( " type=");
+        output.Append( type);
+        output.Append( " />\n");
     }
 
     for ( auto it = sol_edges.begin();
           it != sol_edges.end();
           ++it)
     {
-        unsigned x1 = ( *it).GetPosX1();
-        unsigned y1 = ( *it).GetPosY1();
-        unsigned x2 = ( *it).GetPosX2();
-        unsigned y2 = ( *it).GetPosY2();
+        SMT::Coord x1 = ( *it).GetPosX1();
+        SMT::Coord y1 = ( *it).GetPosY1();
+        SMT::Coord x2 = ( *it).GetPosX2();
+        SMT::Coord y2 = ( *it).GetPosY2();
 
         const char* layer = ( *it).IsInBothLayers() ? "\"undef\"" :
                             ( *it).IsInM2Layer() ? "\"m2\"" :
                             ( *it).IsInM3Layer() ? "\"m3\"" : "\"undef\"";
 
-        output << "    <segment x1=\"" << x1 << "\" y1=\"" << y1 << "\" x2=\"" << x2 << "\" y2=\"" << y2 << "\" layer=" << layer << " />\n";
+        output.Append( "    <segment x1=\"");
+        output.AppendUnsigned( x1);
+        output.Append( "\" y1=\"");
+        output.AppendUnsigned( y1);
+        output.Append( "\" x2=\"");
+        output.AppendUnsigned( x2);
+        output.Append( "\" y2=\"");
+        output.AppendUnsigned( y2);
+        output.Append( "\" layer=");
+        output.Append( layer);
+        output.Append( " />\n");
     }
 
-    output << "</net>";
+    output.Append( "</net>");
+
+    if ( !output.Close() )
+        return BadOutput;
+
+    if ( is_cached )
+        cache.Append( cache_key, cached_solution);
 
     return Success;
 }
@@ -0,0 +1,183 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+namespace
+{
+
+/**
+ *  Counters group of a thread, it is opened on the first read and
+ *  closed when the thread exits
+ */
+class Group
+{
+
+public:
+
+    static const unsigned events_count = 4;
+
+private:
+
+    int fds[ events_count];
+    bool is_opened;
+    bool is_available;
+
+    void Open();
+
+public:
+
+    Group();
+    ~Group();
+    Group( const Group& other) = delete;
+    Group& operator=( const Group& other) = delete;
+
+    bool Read( PerfCounters::Values& values);
+};
+
+#ifdef __linux__
+void Group::Open()
+{
+    const unsigned long long configs[ events_count] = { PERF_COUNT_HW_CPU_CYCLES,
+                                                        PERF_COUNT_HW_INSTRUCTIONS,
+                                                        PERF_COUNT_HW_CACHE_MISSES,
+                                                        PERF_COUNT_HW_BRANCH_MISSES };
+
+    this->is_opened = true;
+
+    for ( unsigned i = 0; i < events_count; ++i)
+    {
+        struct perf_event_attr attr;
+
+        memset( &attr, 0, sizeof( attr));
+        attr.size = sizeof( attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[ i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP
+                           | PERF_FORMAT_TOTAL_TIME_ENABLED
+                           | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        /** Leader starts the whole group */
+        attr.disabled = i == 0;
+
+        this->fds[ i] = syscall( __NR_perf_event_open, &attr, 0, -1, i ? this->fds[ 0] : -1, 0);
+
+        /** Group counts all of its events or nothing */
+        if ( this->fds[ i] < 0 )
+            return;
+    }
+
+    this->is_available = ioctl( this->fds[ 0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) == 0;
+}
+
+Group::~Group()
+{
+    for ( unsigned i = 0; i < events_count && this->fds[ i] >= 0; ++i)
+        close( this->fds[ i]);
+}
+
+bool Group::Read( PerfCounters::Values& values)
+{
+    if ( !this->is_opened )
+        this->Open();
+
+    if ( !this->is_available )
+        return false;
+
+    unsigned long long data[ 3 + events_count];
+
+    if ( read( this->fds[ 0], data, sizeof( data)) != sizeof( data)
+         || data[ 0] != events_count )
+        return false;
+
+    /** Multiplexed counters ran only a part of the time */
+    double scale = data[ 2] ? static_cast<double>( data[ 1]) / data[ 2] : 0;
+
+    values.cycles = data[ 3] * scale;
+    values.instructions = data[ 4] * scale;
+    values.cache_misses = data[ 5] * scale;
+    values.branch_misses = data[ 6] * scale;
+    values.is_counted = true;
+
+    return true;
+}
+#else
+void Group::Open()
+{
+    this->is_opened = true;
+}
+
+Group::~Group()
+{
+}
+
+bool Group::Read( PerfCounters::Values&)
+{
+    return false;
+}
+#endif
+
+Group::Group()
+{
+    this->is_opened = false;
+    this->is_available = false;
+
+    for ( unsigned i = 0; i < events_count; ++i)
+        this->fds[ i] = -1;
+}
+
+}
+
+/** Counters group of the current thread */
+static thread_local Group current_group;
+
+
+/**
+ * ------ PerfCounters ------
+ */
+
+
+PerfCounters::PerfCounters()
+{
+    this->is_enabled = false;
+}
+
+PerfCounters& PerfCounters::GetInstance()
+{
+    static PerfCounters instance;
+    return instance;
+}
+
+bool PerfCounters::Enable()
+{
+    Values values;
+
+    this->is_enabled.store( true, std::memory_order_relaxed);
+
+    return this->Read( values);
+}
+
+void PerfCounters::Disable()
+{
+    this->is_enabled.store( false, std::memory_order_relaxed);
+}
+
+bool PerfCounters::IsEnabled() const
+{
+    return this->is_enabled.load( std::memory_order_relaxed);
+}
+
+bool PerfCounters::Read( Values& values)
+{
+    if ( !this->IsEnabled() )
+        return false;
+
+    return current_group.Read( values);
+}
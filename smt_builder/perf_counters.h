@@ -0,0 +1,57 @@
+#ifndef SMT__PERF_COUNTERS_H
+#define SMT__PERF_COUNTERS_H
+
+#include <atomic>
+
+/**
+ *  Description for perf counters
+ *
+ *  PerfCounters reads hardware counters of the calling thread through
+ *  Linux perf_event_open: cycles, instructions, cache misses and branch
+ *  misses. Counters of a thread are opened as one group on its first
+ *  read, so they are scheduled together and values of a phase are
+ *  comparable. Only user space is counted, which works with default
+ *  perf_event_paranoid.
+ *
+ *  Counters are often missing in VMs and containers or on other
+ *  systems, then reads fail and callers keep timing only. When the
+ *  kernel multiplexes counters values are scaled by running time
+ */
+class PerfCounters
+{
+
+public:
+
+    struct Values
+    {
+        unsigned long long cycles;
+        unsigned long long instructions;
+        unsigned long long cache_misses;
+        unsigned long long branch_misses;
+
+        /** Values were read at least once */
+        bool is_counted;
+    };
+
+private:
+
+    std::atomic<bool> is_enabled;
+
+public:
+
+    PerfCounters();
+    PerfCounters( const PerfCounters& other) = delete;
+    PerfCounters& operator=( const PerfCounters& other) = delete;
+
+    static PerfCounters& GetInstance();
+
+    /** Returns false if counters can't be opened in the calling thread */
+    bool Enable();
+    void Disable();
+    bool IsEnabled() const;
+
+    /** Reads counters of the calling thread since its first read */
+    bool Read( Values& values);
+};
+
+#endif
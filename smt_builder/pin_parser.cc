@@ -0,0 +1,318 @@
+#include "pin_parser.h"
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+/**
+ * ------ SWAR helpers ------
+ */
+
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SMT_PIN_PARSER_SWAR 1
+#else
+#define SMT_PIN_PARSER_SWAR 0
+#endif
+
+static bool IsDigit( char c)
+{
+    return static_cast<unsigned char>( c - '0') < 10;
+}
+
+#if SMT_PIN_PARSER_SWAR
+
+/**
+ *  Number of leading (in memory order) digit characters in chunk
+ */
+static unsigned CountDigits( uint64_t chunk)
+{
+    /** Digit bytes are 0x30..0x39, so both checks give 0x3 in each nibble */
+    uint64_t high = chunk & 0xF0F0F0F0F0F0F0F0ull;
+    uint64_t adjusted = ( ( chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4;
+    uint64_t mismatch = ( high | adjusted) ^ 0x3333333333333333ull;
+
+    /** Set the top bit of every non-zero byte */
+    uint64_t non_digit = ( ( ( mismatch & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | mismatch)
+                         & 0x8080808080808080ull;
+
+    if ( !non_digit )
+        return 8;
+
+    return __builtin_ctzll( non_digit) / 8;
+}
+
+/**
+ *  Value of the first count digits of chunk, count is in [1, 8]
+ */
+static uint64_t ConvertDigits( uint64_t chunk, unsigned count)
+{
+    /** Align digits to the top, low bytes become leading zeroes */
+    chunk -= 0x3030303030303030ull;
+    chunk <<= 8 * ( 8 - count);
+
+    chunk = ( chunk * 10 + ( chunk >> 8)) & 0x00FF00FF00FF00FFull;
+    chunk = ( chunk * 100 + ( chunk >> 16)) & 0x0000FFFF0000FFFFull;
+    chunk = ( chunk * 10000 + ( chunk >> 32)) & 0x00000000FFFFFFFFull;
+
+    return chunk;
+}
+
+#endif
+
+static const uint64_t powers_of_10[] =
+{
+    1ull, 10ull, 100ull, 1000ull, 10000ull,
+    100000ull, 1000000ull, 10000000ull, 100000000ull
+};
+
+
+/**
+ * ------ PinParser ------
+ */
+
+
+PinParser::Result PinParser::ParseDecimal( const char*& str,
+                                           const char* end,
+                                           unsigned long long max_value,
+                                           unsigned long long& value)
+{
+    const char* begin = str;
+    uint64_t result = 0;
+
+    while ( str < end )
+    {
+        unsigned count = 0;
+        uint64_t chunk_value = 0;
+
+#if SMT_PIN_PARSER_SWAR
+        if ( end - str >= 8 )
+        {
+            uint64_t chunk;
+            std::memcpy( &chunk, str, sizeof( chunk));
+
+            count = CountDigits( chunk);
+            if ( count )
+                chunk_value = ConvertDigits( chunk, count);
+        }
+        else
+#endif
+        {
+            for ( ; count < 8 && str + count < end && IsDigit( str[ count]); ++count)
+                chunk_value = chunk_value * 10 + ( str[ count] - '0');
+        }
+
+        if ( !count )
+            break;
+
+        str += count;
+
+        if ( result > ( ULLONG_MAX - chunk_value) / powers_of_10[ count] )
+        {
+            /** Skip the rest of digits, so the caller sees where the number ends */
+            while ( str < end && IsDigit( *str))
+                ++str;
+
+            return OutOfRange;
+        }
+
+        result = result * powers_of_10[ count] + chunk_value;
+
+        if ( count < 8 )
+            break;
+    }
+
+    if ( str == begin )
+        return Unusual;
+
+    if ( result > max_value )
+        return OutOfRange;
+
+    value = result;
+
+    return Parsed;
+}
+
+PinParser::Result PinParser::ParseDecimal( const char* str,
+                                           unsigned long long max_value,
+                                           unsigned long long& value)
+{
+    const char* end = str + std::strlen( str);
+    Result res = ParseDecimal( str, end, max_value, value);
+
+    if ( res == Parsed
+         && str != end )
+        return Unusual;
+
+    return res;
+}
+
+void PinParser::SkipSpaces()
+{
+    while ( this->pos < this->end
+            && ( *this->pos == ' '
+                 || *this->pos == '\t'
+                 || *this->pos == '\n'
+                 || *this->pos == '\r' ) )
+    {
+        ++this->pos;
+    }
+}
+
+bool PinParser::SkipToken( const char* token)
+{
+    std::size_t size = std::strlen( token);
+
+    if ( static_cast<std::size_t>( this->end - this->pos) < size
+         || std::memcmp( this->pos, token, size) )
+        return false;
+
+    this->pos += size;
+
+    return true;
+}
+
+PinParser::Result PinParser::ParseAttribute( const char* name,
+                                             unsigned long long max_value,
+                                             unsigned long long& value)
+{
+    this->SkipSpaces();
+
+    if ( !this->SkipToken( name)
+         || !this->SkipToken( "=\"") )
+        return Unusual;
+
+    Result res = ParseDecimal( this->pos, this->end, max_value, value);
+
+    if ( res == Unusual
+         || !this->SkipToken( "\"") )
+        return Unusual;
+
+    return res;
+}
+
+bool PinParser::ParseAttribute( const char* name, const char* value)
+{
+    this->SkipSpaces();
+
+    return this->SkipToken( name)
+           && this->SkipToken( "=\"")
+           && this->SkipToken( value)
+           && this->SkipToken( "\"");
+}
+
+PinParser::Result PinParser::ParsePin()
+{
+    Pin pin;
+
+    /** There are no valid coordinates for empty grid */
+    unsigned long long max_coord = this->grid_size ? this->grid_size - 1 : 0;
+    bool is_in_range = this->grid_size != 0;
+
+    if ( max_coord > this->max_coord )
+        max_coord = this->max_coord;
+
+    Result res_x = this->ParseAttribute( "x", max_coord, pin.x);
+    if ( res_x == Unusual )
+        return Unusual;
+
+    Result res_y = this->ParseAttribute( "y", max_coord, pin.y);
+    if ( res_y == Unusual )
+        return Unusual;
+
+    if ( !this->ParseAttribute( "layer", "pins")
+         || !this->ParseAttribute( "type", "pin") )
+        return Unusual;
+
+    this->SkipSpaces();
+    if ( !this->SkipToken( "/>") )
+        return Unusual;
+
+    /** Shape is checked first, so unusual input always goes to the generic parser */
+    if ( res_x == OutOfRange
+         || res_y == OutOfRange
+         || !is_in_range )
+        return OutOfRange;
+
+    this->pins.push_back( pin);
+
+    return Parsed;
+}
+
+PinParser::PinParser( const char* text, std::size_t size, unsigned long long max_coord)
+{
+    this->pos = text;
+    this->end = text + size;
+    this->max_coord = max_coord;
+    this->grid_size = 0;
+    this->pin_count = 0;
+}
+
+PinParser::Result PinParser::Parse()
+{
+    Result res = Parsed;
+
+    this->SkipSpaces();
+    if ( !this->SkipToken( "<net") )
+        return Unusual;
+
+    Result res_grid = this->ParseAttribute( "grid_size", ULLONG_MAX, this->grid_size);
+    if ( res_grid == Unusual )
+        return Unusual;
+
+    Result res_pins = this->ParseAttribute( "pin_count", UINT_MAX, this->pin_count);
+    if ( res_pins == Unusual )
+        return Unusual;
+
+    this->SkipSpaces();
+    if ( !this->SkipToken( ">") )
+        return Unusual;
+
+    if ( res_grid == OutOfRange
+         || res_pins == OutOfRange )
+        res = OutOfRange;
+
+    /** pin_count is not trusted, every pin takes more than 16 chars anyway */
+    std::size_t max_pins = ( this->end - this->pos) / 16;
+    this->pins.reserve( this->pin_count < max_pins ? this->pin_count : max_pins);
+
+    while ( true )
+    {
+        this->SkipSpaces();
+
+        if ( this->SkipToken( "</net>") )
+            break;
+
+        if ( !this->SkipToken( "<point") )
+            return Unusual;
+
+        Result res_pin = this->ParsePin();
+        if ( res_pin == Unusual )
+            return Unusual;
+
+        if ( res_pin == OutOfRange )
+            res = OutOfRange;
+    }
+
+    this->SkipSpaces();
+
+    /** Buffer may be null-terminated */
+    if ( this->pos != this->end
+         && !( this->pos + 1 == this->end && *this->pos == '\0' ) )
+        return Unusual;
+
+    return res;
+}
+
+unsigned long long PinParser::GetGridSize()
+{
+    return this->grid_size;
+}
+
+unsigned long long PinParser::GetPinCount()
+{
+    return this->pin_count;
+}
+
+std::vector<PinParser::Pin>& PinParser::GetPins()
+{
+    return this->pins;
+}
@@ -0,0 +1,78 @@
+#ifndef SMT__PIN_PARSER_H
+#define SMT__PIN_PARSER_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ *  Description for pin parser
+ *
+ *  Pin parser recognizes benchmarks of the fixed shape produced by
+ *  the pin generator:
+ *
+ *      <net grid_size="N" pin_count="M">
+ *          <point x="X" y="Y" layer="pins" type="pin" />
+ *          ...
+ *      </net>
+ *
+ *  Digits are parsed 8 at a time (SWAR) and coordinates are checked
+ *  against grid size and the max coordinate in the same pass. Anything else is reported as
+ *  unusual, so the caller can fall back to the generic XML parser
+ */
+class PinParser
+{
+
+public:
+
+    /**
+     *  Parsing results
+     */
+    enum Result
+    {
+        /** bench is parsed */
+        Parsed,
+
+        /** bench doesn't have the fixed shape, use generic parser */
+        Unusual,
+
+        /** bench has the fixed shape but a number is out of range */
+        OutOfRange
+    };
+
+    struct Pin
+    {
+        unsigned long long x;
+        unsigned long long y;
+    };
+
+private:
+
+    const char* pos;
+    const char* end;
+    unsigned long long max_coord;
+
+    unsigned long long grid_size;
+    unsigned long long pin_count;
+    std::vector<Pin> pins;
+
+    void SkipSpaces();
+    bool SkipToken( const char* token);
+    Result ParseAttribute( const char* name, unsigned long long max_value, unsigned long long& value);
+    bool ParseAttribute( const char* name, const char* value);
+    Result ParsePin();
+
+public:
+
+    PinParser( const char* text, std::size_t size, unsigned long long max_coord);
+
+    Result Parse();
+
+    unsigned long long GetGridSize();
+    unsigned long long GetPinCount();
+    std::vector<Pin>& GetPins();
+
+    static Result ParseDecimal( const char*& str, const char* end, unsigned long long max_value, unsigned long long& value);
+    static Result ParseDecimal( const char* str, unsigned long long max_value, unsigned long long& value);
+};
+
+#endif
@@ -53,10 +53,20 @@ if __name__ == "__main__":
     parser.add_argument("output", help="directory for solutions")
     parser.add_argument("-s", "--summary_file", type=str, default="summary",
                         help="summary_file")
+    parser.add_argument("-c", "--cache", type=str, default=None,
+                        help="disk cache file for solutions (default: None - no cache)")
+    parser.add_argument("-p", "--pattern_cache", action="store_true",
+                        help="reuse Steiner points of nets with the same pin pattern")
 
     args = parser.parse_args()
 
     check_input(args.input)
     make_output_dir(args.output)
 
+    if args.cache is not None:
+        os.environ["SMT_CACHE"] = os.path.abspath(args.cache)
+
+    if args.pattern_cache:
+        os.environ["SMT_PATTERN_CACHE"] = "1"
+
     run_benchmarks("./main.out", args.input, args.output)
@@ -1,5 +1,82 @@
 #include "smt.h"
+#include "tracer.h"
 #include <cstddef>
+#include <utility>
+#include <unordered_set>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+/** Stats are counted only when they are compiled in */
+#ifdef SMT_STATS
+#define SMT_COUNT( counter, value) ( this->stats.counter += ( value) )
+#else
+#define SMT_COUNT( counter, value) ( ( void)0 )
+#endif
+
+namespace
+{
+
+/**
+ *  Timer adds time and hardware counters of its scope to a phase
+ *  of stats and records the phase for the tracer
+ */
+class PhaseTimer
+{
+
+private:
+
+    Tracer::Scope scope;
+
+#ifdef SMT_STATS
+    double& time;
+    PerfCounters::Values& counters;
+    PerfCounters::Values start_counters;
+    bool is_counted;
+    std::chrono::steady_clock::time_point start;
+
+    /** Scaled multiplexed counters may go slightly back */
+    static unsigned long long Delta( unsigned long long stop, unsigned long long start)
+    {
+        return stop > start ? stop - start : 0;
+    }
+
+public:
+
+    PhaseTimer( double& time, PerfCounters::Values& counters, const char* name, unsigned long long net)
+        : scope( name, net), time( time), counters( counters)
+    {
+        this->is_counted = PerfCounters::GetInstance().Read( this->start_counters);
+        this->start = std::chrono::steady_clock::now();
+    }
+
+    ~PhaseTimer()
+    {
+        PerfCounters::Values stop_counters;
+
+        this->time += std::chrono::duration<double>( std::chrono::steady_clock::now() - this->start).count();
+
+        if ( !this->is_counted
+             || !PerfCounters::GetInstance().Read( stop_counters) )
+            return;
+
+        this->counters.cycles += Delta( stop_counters.cycles, this->start_counters.cycles);
+        this->counters.instructions += Delta( stop_counters.instructions, this->start_counters.instructions);
+        this->counters.cache_misses += Delta( stop_counters.cache_misses, this->start_counters.cache_misses);
+        this->counters.branch_misses += Delta( stop_counters.branch_misses, this->start_counters.branch_misses);
+        this->counters.is_counted = true;
+    }
+#else
+public:
+
+    PhaseTimer( double&, PerfCounters::Values&, const char* name, unsigned long long net)
+        : scope( name, net)
+    {
+    }
+#endif
+};
+
+}
 
 /**
  * ------ SMT::Marker ------
@@ -52,12 +129,12 @@ void SMT::Marker::InitByPoint( Point* point)
     point->SetMarker( this);
 }
 
-unsigned SMT::Marker::GetId()
+unsigned SMT::Marker::GetId() const
 {
     return this->id;
 }
 
-unsigned SMT::Marker::GetCounter()
+unsigned SMT::Marker::GetCounter() const
 {
     return this->counter;
 }
@@ -67,32 +144,37 @@ unsigned SMT::Marker::GetCounter()
  */
 
 
-unsigned SMT::Point::GetPosX()
+SMT::Coord SMT::Point::GetPosX() const
 {
     return this->posX;
 }
 
-unsigned SMT::Point::GetPosY()
+SMT::Coord SMT::Point::GetPosY() const
 {
     return this->posY;
 }
 
+const SMT::Marker* SMT::Point::GetMarker() const
+{
+    return this->marker;
+}
+
 SMT::Marker* SMT::Point::GetMarker()
 {
     return this->marker;
 }
 
-unsigned SMT::Point::GetSCCId()
+unsigned SMT::Point::GetSCCId() const
 {
     return this->marker->GetId();
 }
 
-unsigned SMT::Point::GetSCCCounter()
+unsigned SMT::Point::GetSCCCounter() const
 {
     return this->marker->GetCounter();
 }
 
-SMT::Point::PointType SMT::Point::GetType()
+SMT::Point::PointType SMT::Point::GetType() const
 {
     return this->type;
 }
@@ -107,17 +189,17 @@ void SMT::Point::SetType( PointType t)
     this->type = t;
 }
 
-bool SMT::Point::IsPin()
+bool SMT::Point::IsPin() const
 {
     return this->type == Pin;
 }
 
-bool SMT::Point::IsInvalid()
+bool SMT::Point::IsInvalid() const
 {
     return this->type == Invalid;
 }
 
-bool SMT::Point::IsInBothLayers()
+bool SMT::Point::IsInBothLayers() const
 {
     bool is_in_m2 = false;
     bool is_in_m3 = false;
@@ -136,7 +218,7 @@ bool SMT::Point::IsInBothLayers()
     return is_in_m2 && is_in_m3;
 }
 
-bool SMT::Point::IsInM3Layer()
+bool SMT::Point::IsInM3Layer() const
 {
     for ( auto it = this->edges.begin();
           it != this->edges.end();
@@ -149,18 +231,18 @@ bool SMT::Point::IsInM3Layer()
     return false;
 }
 
-bool SMT::Point::IsPinsM2()
+bool SMT::Point::IsPinsM2() const
 {
     return this->type == Pins_M2;
 }
 
-void SMT::Point::FinalizeType()
+void SMT::Point::FinalizeType( bool is_in_m2, bool is_in_m3)
 {
     if ( this->IsPin()
          || this->IsPinsM2() )
         return;
 
-    if ( this->IsInBothLayers() )
+    if ( is_in_m2 && is_in_m3 )
         this->type = M2_M3;
     else
         this->type = Invalid;
@@ -181,8 +263,13 @@ void SMT::Point::Unlink( SMT::Edge* edge)
     this->edges.remove_if( [ edge]( Edge* e) { return e == edge; });
 }
 
-SMT::Point::Point( unsigned x,
-                   unsigned y,
+const std::list<SMT::Edge*>& SMT::Point::GetEdges()
+{
+    return this->edges;
+}
+
+SMT::Point::Point( Coord x,
+                   Coord y,
                    PointType t)
 {
     this->posX = x;
@@ -216,52 +303,52 @@ SMT::Point& SMT::Point::operator=( const SMT::Point& other)
  */
 
 
-unsigned SMT::Edge::GetLength()
+SMT::Length SMT::Edge::GetLength() const
 {
     return this->length;
 }
 
-unsigned SMT::Edge::GetPosX1()
+SMT::Coord SMT::Edge::GetPosX1() const
 {
     return this->point1->GetPosX();
 }
 
-unsigned SMT::Edge::GetPosY1()
+SMT::Coord SMT::Edge::GetPosY1() const
 {
     return this->point1->GetPosY();
 }
 
-unsigned SMT::Edge::GetPosX2()
+SMT::Coord SMT::Edge::GetPosX2() const
 {
     return this->point2->GetPosX();
 }
 
-unsigned SMT::Edge::GetPosY2()
+SMT::Coord SMT::Edge::GetPosY2() const
 {
     return this->point2->GetPosY();
 }
 
-bool SMT::Edge::IsTemporary()
+bool SMT::Edge::IsTemporary() const
 {
     return this->status == Temporary;
 }
 
-bool SMT::Edge::IsInOneSCC()
+bool SMT::Edge::IsInOneSCC() const
 {
     return this->point1->GetSCCId() == this->point2->GetSCCId();
 }
 
-bool SMT::Edge::IsInM2Layer()
+bool SMT::Edge::IsInM2Layer() const
 {
     return this->GetPosY1() == this->GetPosY2();
 }
 
-bool SMT::Edge::IsInM3Layer()
+bool SMT::Edge::IsInM3Layer() const
 {
     return this->GetPosX1() == this->GetPosX2();
 }
 
-bool SMT::Edge::IsInBothLayers()
+bool SMT::Edge::IsInBothLayers() const
 {
     return !this->IsInM2Layer() && !this->IsInM3Layer();
 }
@@ -290,7 +377,7 @@ void SMT::Edge::FinalLink()
     this->point2->Link( this);
 }
 
-unsigned SMT::Edge::GetSCCCounter()
+unsigned SMT::Edge::GetSCCCounter() const
 {
     if ( this->IsInOneSCC() )
         return this->point1->GetSCCCounter();
@@ -298,6 +385,16 @@ unsigned SMT::Edge::GetSCCCounter()
     return 0;
 }
 
+const SMT::Point* SMT::Edge::GetPoint1() const
+{
+    return this->point1;
+}
+
+const SMT::Point* SMT::Edge::GetPoint2() const
+{
+    return this->point2;
+}
+
 SMT::Point* SMT::Edge::GetPoint1()
 {
     return this->point1;
@@ -316,10 +413,10 @@ SMT::Edge::Edge( Point* p1,
     this->point2 = p2;
     this->status = s;
 
-    unsigned x1 = p1->GetPosX(),
-             y1 = p1->GetPosY(),
-             x2 = p2->GetPosX(),
-             y2 = p2->GetPosY();
+    Coord x1 = p1->GetPosX(),
+          y1 = p1->GetPosY(),
+          x2 = p2->GetPosX(),
+          y2 = p2->GetPosY();
 
     if ( x1 > x2 )
         std::swap( x1, x2);
@@ -327,40 +424,172 @@ SMT::Edge::Edge( Point* p1,
     if ( y1 > y2 )
         std::swap( y1, y2);
 
-    this->length = ( x2 - x1 ) + ( y2 - y1 );
+    this->length = static_cast<Length>( x2 - x1 ) + ( y2 - y1 );
+}
+
+SMT::Edge::Edge( const Edge& other,
+                 Point* p1,
+                 Point* p2)
+{
+    this->point1 = p1;
+    this->point2 = p2;
+    this->status = other.status;
+    this->length = other.length;
+}
+
+
+/**
+ * ------ SMT::Limits ------
+ */
+
+
+SMT::Limits::Limits()
+{
+    this->deadline = Clock::time_point::max();
+    this->time_limit = Clock::duration::zero();
+    this->max_iterations = 0;
+    this->max_evaluations = 0;
+}
+
+void SMT::Limits::SetDeadline( Clock::time_point deadline)
+{
+    this->deadline = deadline;
+}
+
+void SMT::Limits::SetTimeLimit( Clock::duration time_limit)
+{
+    this->time_limit = time_limit;
+}
+
+void SMT::Limits::SetMaxIterations( unsigned max_iterations)
+{
+    this->max_iterations = max_iterations;
+}
+
+void SMT::Limits::SetMaxEvaluations( unsigned long long max_evaluations)
+{
+    this->max_evaluations = max_evaluations;
+}
+
+SMT::Limits::Clock::time_point SMT::Limits::GetDeadline( Clock::time_point start) const
+{
+    if ( this->time_limit <= Clock::duration::zero() )
+        return this->deadline;
+
+    Clock::time_point relative = start + this->time_limit;
+
+    return relative < this->deadline ? relative : this->deadline;
+}
+
+unsigned SMT::Limits::GetMaxIterations() const
+{
+    return this->max_iterations;
+}
+
+unsigned long long SMT::Limits::GetMaxEvaluations() const
+{
+    return this->max_evaluations;
+}
+
+
+/**
+ * ------ SMT::CancellationToken ------
+ */
+
+
+SMT::CancellationToken::CancellationToken()
+{
+    this->is_cancelled = false;
+}
+
+void SMT::CancellationToken::Cancel()
+{
+    this->is_cancelled.store( true, std::memory_order_relaxed);
+}
+
+void SMT::CancellationToken::Reset()
+{
+    this->is_cancelled.store( false, std::memory_order_relaxed);
+}
+
+bool SMT::CancellationToken::IsCancelled() const
+{
+    return this->is_cancelled.load( std::memory_order_relaxed);
 }
 
 
 /**
- * ------ SMT::Cell ------
+ * ------ SMT::Box ------
  */
 
 
-bool SMT::Cell::IsHanan()
+SMT::Box::Box()
 {
-    return this->is_hanan_x && this->is_hanan_y && !this->is_pin;
+    this->min_x = 0;
+    this->min_y = 0;
+    this->max_x = 0;
+    this->max_y = 0;
+    this->is_empty = true;
 }
 
-void SMT::Cell::SetHananX( bool is_hanan_x)
+bool SMT::Box::IsEmpty() const
 {
-    this->is_hanan_x = is_hanan_x;
+    return this->is_empty;
 }
 
-void SMT::Cell::SetHananY( bool is_hanan_y)
+bool SMT::Box::Contains( Coord x, Coord y) const
 {
-    this->is_hanan_y = is_hanan_y;
+    return !this->is_empty
+           && x >= this->min_x && x <= this->max_x
+           && y >= this->min_y && y <= this->max_y;
 }
 
-void SMT::Cell::SetPin( bool is_pin)
+void SMT::Box::AddPoint( Coord x, Coord y)
 {
-    this->is_pin = is_pin;
+    if ( this->is_empty )
+    {
+        this->min_x = this->max_x = x;
+        this->min_y = this->max_y = y;
+        this->is_empty = false;
+        return;
+    }
+
+    if ( x < this->min_x )
+        this->min_x = x;
+
+    if ( x > this->max_x )
+        this->max_x = x;
+
+    if ( y < this->min_y )
+        this->min_y = y;
+
+    if ( y > this->max_y )
+        this->max_y = y;
+}
+
+void SMT::Box::AddPoint( Point* point)
+{
+    this->AddPoint( point->GetPosX(), point->GetPosY());
+}
+
+SMT::Coord SMT::Box::GetMinX() const
+{
+    return this->min_x;
+}
+
+SMT::Coord SMT::Box::GetMinY() const
+{
+    return this->min_y;
 }
 
-SMT::Cell::Cell()
+SMT::Coord SMT::Box::GetMaxX() const
 {
-    this->is_hanan_x = false;
-    this->is_hanan_y = false;
-    this->is_pin = false;
+    return this->max_x;
+}
+
+SMT::Coord SMT::Box::GetMaxY() const
+{
+    return this->max_y;
 }
 
 
@@ -369,13 +598,17 @@ SMT::Cell::Cell()
  */
 
 
-void SMT::AddHananPoint( unsigned x, unsigned y)
+const SMT::Length SMT::no_length;
+
+
+void SMT::AddHananPoint( Coord x, Coord y)
 {
     Point* point = new Point( x, y, Point::Hanan);
     this->hanan_points.push_back( point);
+    SMT_COUNT( allocations, 1);
 }
 
-void SMT::AddExistingPoint( unsigned x, unsigned y, Point::PointType t, Edge::Status s)
+void SMT::AddExistingPoint( Coord x, Coord y, Point::PointType t, Edge::Status s)
 {
     Point* point = new Point( x, y, t);
 
@@ -389,32 +622,140 @@ void SMT::AddExistingPoint( unsigned x, unsigned y, Point::PointType t, Edge::St
     Marker* marker = new Marker( this->num_of_points);
     marker->InitByPoint( point);
     this->markers.push_back( marker);
+    SMT_COUNT( allocations, 2);
 
     this->existing_points.push_back( point);
     this->num_of_points++;
 }
 
-void SMT::AddPseudoPoint( unsigned x, unsigned y)
+void SMT::AddPseudoPoint( Coord x, Coord y)
 {
     this->AddExistingPoint( x, y, Point::Pseudo, Edge::Valid);
 }
 
-void SMT::AddTemporaryPoint( unsigned x, unsigned y)
+void SMT::AddTemporaryPoint( Coord x, Coord y)
 {
     this->AddExistingPoint( x, y, Point::Pseudo, Edge::Temporary);
 }
 
-void SMT::AddPin( unsigned x, unsigned y)
+void SMT::AddPin( Coord x, Coord y)
 {
+    /** Coincident pins are merged, a seed at the same place becomes a pin */
+    unsigned i = 0;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        if ( ( *it)->GetPosX() != x
+             || ( *it)->GetPosY() != y )
+            continue;
+
+        if ( ( *it)->IsPin() )
+            return;
+
+        if ( !this->finalized )
+        {
+            ( *it)->SetType( Point::Pin);
+            return;
+        }
+
+        /** Tree stays the same, only vias of the point change */
+        this->Unfinalize();
+        ( *it)->SetType( Point::Pin);
+        this->CalculateMST( true);
+        this->FinalizeSMT();
+        return;
+    }
+
+    if ( !this->finalized )
+    {
+        this->AddExistingPoint( x, y, Point::Pin, Edge::Valid);
+        return;
+    }
+
+    /** SMT is already built, so we only rebuild around the new pin */
+    Box box;
+
+    this->Unfinalize();
     this->AddExistingPoint( x, y, Point::Pin, Edge::Valid);
+    this->CalculateMST( true);
+    this->AddNeighboursToBox( this->existing_points.back(), box);
+    this->RepairSMT( box);
+}
+
+bool SMT::AddSteinerPoint( Coord x, Coord y)
+{
+    if ( this->finalized
+         || x >= this->width
+         || y >= this->height )
+        return false;
+
+    for ( auto it = this->existing_points.begin();
+          it != this->existing_points.end();
+          ++it)
+    {
+        if ( ( *it)->GetPosX() == x
+             && ( *it)->GetPosY() == y )
+            return false;
+    }
+
+    this->AddPseudoPoint( x, y);
+
+    return true;
+}
+
+bool SMT::RemovePin( Coord x, Coord y)
+{
+    if ( !this->finalized )
+    {
+        auto point_it = this->FindPin( x, y);
+        if ( point_it == this->existing_points.end() )
+            return false;
+
+        this->RemoveExistingPoint( point_it);
+        return true;
+    }
+
+    Box box;
+
+    this->Unfinalize();
+    this->CalculateMST( true);
+
+    auto point_it = this->FindPin( x, y);
+    if ( point_it == this->existing_points.end() )
+    {
+        this->FinalizeSMT();
+        return false;
+    }
+
+    this->AddNeighboursToBox( *point_it, box);
+    this->RemoveExistingPoint( point_it);
+    this->CalculateMST( true);
+    this->RepairSMT( box);
+
+    return true;
+}
+
+bool SMT::MovePin( Coord x, Coord y, Coord new_x, Coord new_y)
+{
+    if ( !this->RemovePin( x, y) )
+        return false;
+
+    this->AddPin( new_x, new_y);
+
+    return true;
 }
 
 void SMT::AddEdge( Point* p1, Point* p2, Edge::Status s)
 {
     Edge* edge = new Edge( p1, p2, s);
-    unsigned length = edge->GetLength();
+    Length length = edge->GetLength();
     std::list<Edge*>::iterator it;
 
+    SMT_COUNT( edges_inserted, 1);
+    SMT_COUNT( allocations, 1);
+
     for ( it = this->edges.begin();
           it != this->edges.end() && length > ( *it)->GetLength();
           ++it);
@@ -485,72 +826,122 @@ void SMT::ResetMarkers()
     }
 }
 
-unsigned SMT::GetGridSize()
+SMT::Coord SMT::GetGridSize() const
 {
-    return this->grid_size;
+    /** Grid size is known only for square grids */
+    return this->width == this->height ? this->width : 0;
 }
 
-unsigned SMT::GetPinCount()
+SMT::Coord SMT::GetWidth() const
+{
+    return this->width;
+}
+
+SMT::Coord SMT::GetHeight() const
+{
+    return this->height;
+}
+
+unsigned SMT::GetPinCount() const
 {
     return this->pin_count;
 }
 
+namespace
+{
+
+struct CoordPairHash
+{
+    std::size_t operator()( const std::pair<SMT::Coord, SMT::Coord>& pos) const
+    {
+        unsigned long long hash = static_cast<unsigned long long>( pos.first) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>( hash ^ ( pos.second + ( hash >> 29)));
+    }
+};
+
+}
+
 void SMT::CollectHananPoints()
 {
-    Cell** cell = new Cell* [ this->grid_size];
-    for ( unsigned i = 0; i < this->grid_size; ++i)
+    /**
+     *  Hanan points are crossings of pins' rows and columns, so we take
+     *  them from sorted coordinates instead of marking the whole grid.
+     *  It doesn't depend on grid size and keeps the same order
+     */
+    Box box;
+    unsigned i = 0;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
     {
-        cell[ i] = new Cell [ this->grid_size];
+        if ( ( *it)->IsPin() )
+            box.AddPoint( *it);
     }
 
-    this->ClearListOfPointers( this->hanan_points);
+    if ( box.IsEmpty() )
+    {
+        this->ClearListOfPointers( this->hanan_points);
+        return;
+    }
 
-    for ( std::list<Point*>::iterator it = this->existing_points.begin();
-          it != this->existing_points.end();
-          ++it)
+    this->CollectLocalHananPoints( box, this->hanan_points);
+}
+
+void SMT::CollectLocalHananPoints( Box& box, std::list<Point*>& candidates)
+{
+    PhaseTimer timer( this->stats.hanan_time, this->stats.hanan_counters, "hanan", this->trace_id);
+    std::list<Coord> xs;
+    std::list<Coord> ys;
+    std::unordered_set<std::pair<Coord, Coord>, CoordPairHash> taken;
+    unsigned i = 0;
+
+    this->ClearListOfPointers( candidates);
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
     {
+        Coord x = ( *it)->GetPosX();
+        Coord y = ( *it)->GetPosY();
+
+        taken.insert( std::make_pair( x, y));
+
         if ( !( *it)->IsPin() )
             continue;
 
-        unsigned pinX = ( *it)->GetPosX();
-        unsigned pinY = ( *it)->GetPosY();
+        if ( x >= box.GetMinX() && x <= box.GetMaxX() )
+            xs.push_back( x);
 
-        cell[ pinX][ pinY].SetPin( true);
-
-        /** grid is a square, so we can pass the row and a column at the same time */
-        for ( unsigned pos = 0;
-              pos < this->grid_size;
-              ++pos)
-        {
-            cell[ pos][ pinY].SetHananY( true);
-            cell[ pinX][ pos].SetHananX( true);
-        }
+        if ( y >= box.GetMinY() && y <= box.GetMaxY() )
+            ys.push_back( y);
     }
 
-    for ( unsigned x = 0;
-          x < this->grid_size;
-          ++x)
+    xs.sort();
+    xs.unique();
+    ys.sort();
+    ys.unique();
+
+    for ( auto it_x = xs.begin();
+          it_x != xs.end();
+          ++it_x)
     {
-        for ( unsigned y = 0;
-              y < this->grid_size;
-              ++y)
+        for ( auto it_y = ys.begin();
+              it_y != ys.end();
+              ++it_y)
         {
-            if ( cell[ x][ y].IsHanan() )
-                this->AddHananPoint( x, y);
-        }
-    }
+            if ( taken.count( std::make_pair( *it_x, *it_y)) )
+                continue;
 
-    for ( unsigned i = 0; i < this->grid_size; ++i)
-    {
-        delete [] cell[ i];
+            candidates.push_back( new Point( *it_x, *it_y, Point::Hanan));
+            SMT_COUNT( allocations, 1);
+        }
     }
-
-    delete [] cell;
 }
 
-unsigned SMT::CalculateMST( bool to_finalize)
+SMT::Length SMT::CalculateMST( bool to_finalize)
 {
-    unsigned length = 0;
+    Length length = 0;
     unsigned scc_counter = 1;
 
     if ( to_finalize )
@@ -562,6 +953,8 @@ unsigned SMT::CalculateMST( bool to_finalize)
           it != this->edges.end() && scc_counter != this->num_of_points;
           ++it)
     {
+        SMT_COUNT( edges_scanned, 1);
+
         if ( ( *it)->IsInOneSCC() )
             continue;
 
@@ -583,31 +976,55 @@ unsigned SMT::CalculateMST( bool to_finalize)
     }
 
     if ( scc_counter != this->num_of_points )
-        length = -1;
+        length = no_length;
     else if ( to_finalize )
         this->current_MST_length = length;
 
     return length;
 }
 
-unsigned SMT::CalculateMST()
+SMT::Length SMT::CalculateMST()
 {
     return this->CalculateMST( false);
 }
 
 bool SMT::SMTIteration()
 {
-    unsigned new_length = -1;
+    return this->SMTIteration( this->hanan_points);
+}
+
+bool SMT::SMTIteration( std::list<Point*>& candidates)
+{
+    if ( this->executor
+         && this->executor->GetThreadsCount() > 1
+         && this->current_MST_length != no_length
+         && static_cast<unsigned long long>( candidates.size()) * this->num_of_points >= parallel_threshold )
+        return this->SMTIterationParallel( candidates);
+
+    Length new_length = no_length;
     Point* winner = nullptr;
     std::list<Point*>::iterator it, winner_it;
 
-    for ( it = this->hanan_points.begin();
-          it != this->hanan_points.end();
+    for ( it = candidates.begin();
+          it != candidates.end();
           ++it)
     {
-        unsigned length = -1;
+        Length length = no_length;
         Point* hanan = *it;
 
+        /** Best candidate checked so far is still taken */
+        if ( this->IsOutOfLimits() )
+        {
+            this->converged = false;
+            break;
+        }
+
+        this->evaluations++;
+
+        if ( this->progress_callback
+             && this->evaluations % progress_period == 0 )
+            this->ReportProgress( this->evaluations);
+
         this->ResetMarkers();
 
         this->AddTemporaryPoint( hanan->GetPosX(), hanan->GetPosY());
@@ -630,113 +1047,1511 @@ bool SMT::SMTIteration()
 
     this->AddPseudoPoint( winner->GetPosX(), winner->GetPosY());
     delete *winner_it;
-    this->hanan_points.erase( winner_it);
+    candidates.erase( winner_it);
     this->CalculateMST( true);
 
     return true;
 }
 
-void SMT::FinalizeSMT()
+/**
+ * ------ Parallel candidates evaluation ------
+ */
+
+
+namespace
 {
-    this->finalized = true;
-    unsigned i = 0;
 
-    for ( auto it = this->existing_points.begin();
-          i < this->num_of_points;
-          ++it, ++i)
-    {
-        ( *it)->FinalizeType();
+struct TreeEdge
+{
+    SMT::Length length;
+    unsigned point1;
+    unsigned point2;
+};
 
-        if ( !( *it)->IsPin() )
-            continue;
+/**
+ *  Evaluator calculates MST length for the tree with one more point
+ *  without changing the SMT, so candidates can be checked by several
+ *  threads. New MST consists only of current MST edges and edges of
+ *  the new point, so it takes O(n log n) instead of O(n^2)
+ */
+class CandidateEvaluator
+{
 
-        Point* pins_m2 = new Point( **it);
-        pins_m2->SetType( Point::Pins_M2);
-        this->existing_points.push_back( pins_m2);
+private:
 
-        if ( !( *it)->IsInM3Layer() )
-            continue;
+    const std::vector<SMT::Coord>& xs;
+    const std::vector<SMT::Coord>& ys;
+    const std::vector<TreeEdge>& tree;
 
-        Point* m2_m3 = new Point( **it);
-        m2_m3->SetType( Point::M2_M3);
-        this->existing_points.push_back( m2_m3);
-    }
+    std::vector<std::pair<SMT::Length, unsigned> > new_edges;
+    std::vector<unsigned> parent;
 
-    for ( auto it = this->existing_edges.begin();
-          it != this->existing_edges.end(); )
+    unsigned Find( unsigned point)
+    {
+        while ( this->parent[ point] != point )
+        {
+            this->parent[ point] = this->parent[ this->parent[ point]];
+            point = this->parent[ point];
+        }
+
+        return point;
+    }
+
+    bool Unite( unsigned point1, unsigned point2)
+    {
+        point1 = this->Find( point1);
+        point2 = this->Find( point2);
+
+        if ( point1 == point2 )
+            return false;
+
+        this->parent[ point1] = point2;
+
+        return true;
+    }
+
+public:
+
+    CandidateEvaluator( const std::vector<SMT::Coord>& xs,
+                        const std::vector<SMT::Coord>& ys,
+                        const std::vector<TreeEdge>& tree)
+        : xs( xs), ys( ys), tree( tree)
+    {
+        this->new_edges.resize( xs.size());
+        this->parent.resize( xs.size() + 1);
+    }
+
+    SMT::Length Evaluate( SMT::Coord x, SMT::Coord y)
+    {
+        unsigned count = this->xs.size();
+        SMT::Length length = 0;
+        unsigned linked = 0;
+
+        for ( unsigned i = 0; i < count; ++i)
+        {
+            SMT::Length dx = x > this->xs[ i] ? x - this->xs[ i] : this->xs[ i] - x;
+            SMT::Length dy = y > this->ys[ i] ? y - this->ys[ i] : this->ys[ i] - y;
+
+            this->new_edges[ i] = std::make_pair( dx + dy, i);
+            this->parent[ i] = i;
+        }
+
+        this->parent[ count] = count;
+        std::sort( this->new_edges.begin(), this->new_edges.end());
+
+        auto it_tree = this->tree.begin();
+        auto it_new = this->new_edges.begin();
+
+        while ( linked < count
+                && ( it_tree != this->tree.end() || it_new != this->new_edges.end() ) )
+        {
+            if ( it_new == this->new_edges.end()
+                 || ( it_tree != this->tree.end() && it_tree->length <= it_new->first ) )
+            {
+                if ( this->Unite( it_tree->point1, it_tree->point2) )
+                {
+                    length += it_tree->length;
+                    linked++;
+                }
+
+                ++it_tree;
+            }
+            else
+            {
+                if ( this->Unite( count, it_new->second) )
+                {
+                    length += it_new->first;
+                    linked++;
+                }
+
+                ++it_new;
+            }
+        }
+
+        return length;
+    }
+};
+
+}
+
+bool SMT::SMTIterationParallel( std::list<Point*>& candidates)
+{
+    std::vector<Coord> xs;
+    std::vector<Coord> ys;
+    std::vector<TreeEdge> tree;
+    std::vector<std::list<Point*>::iterator> order;
+    std::unordered_map<const Point*, unsigned> point_index;
+    unsigned i = 0;
+
+    xs.reserve( this->num_of_points);
+    ys.reserve( this->num_of_points);
+    point_index.reserve( this->num_of_points);
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        point_index[ *it] = i;
+        xs.push_back( ( *it)->GetPosX());
+        ys.push_back( ( *it)->GetPosY());
+    }
+
+    /** Existing edges are added by Kruskal, so they are already sorted */
+    for ( auto it = this->existing_edges.begin();
+          it != this->existing_edges.end();
+          ++it)
+    {
+        TreeEdge edge;
+        edge.length = ( *it)->GetLength();
+        edge.point1 = point_index[ ( *it)->GetPoint1()];
+        edge.point2 = point_index[ ( *it)->GetPoint2()];
+        tree.push_back( edge);
+    }
+
+    for ( auto it = candidates.begin();
+          it != candidates.end();
+          ++it)
+    {
+        order.push_back( it);
+    }
+
+    unsigned long long max_evaluations = this->limits.GetMaxEvaluations();
+    std::size_t limit = order.size();
+
+    /** Budget goes to candidates in order, so a limited round evaluates the same ones as the serial loop */
+    if ( max_evaluations )
+    {
+        unsigned long long budget = max_evaluations > this->evaluations ? max_evaluations - this->evaluations : 0;
+        limit = std::min<unsigned long long>( budget, limit);
+    }
+
+    std::size_t chunks_count = this->executor->GetThreadsCount() * 4;
+    std::size_t chunk_size = ( limit + chunks_count - 1) / chunks_count;
+    if ( chunk_size < 8 )
+        chunk_size = 8;
+
+    chunks_count = ( limit + chunk_size - 1) / chunk_size;
+
+    /** Best length and its candidate for every chunk */
+    std::vector<std::pair<Length, std::size_t> > results( chunks_count, std::make_pair( no_length, order.size()));
+
+    /** Candidates really evaluated by every chunk */
+    std::vector<unsigned long long> evaluated( chunks_count, 0);
+    Executor::Group remaining( chunks_count);
+    std::atomic<bool> is_interrupted( limit < order.size());
+    Length current_length = this->current_MST_length;
+
+    /** Evaluations of the round for progress reports, they are sent one at a time in order */
+    std::atomic<unsigned long long> progress_evaluated( 0);
+    unsigned long long reported = 0;
+    std::mutex progress_lock;
+
+    for ( std::size_t chunk = 0; chunk < chunks_count; ++chunk)
+    {
+        this->executor->Submit( [ &, chunk]()
+        {
+            CandidateEvaluator evaluator( xs, ys, tree);
+            std::size_t end = std::min( limit, ( chunk + 1) * chunk_size);
+            std::size_t c;
+            Tracer::Scope scope( "candidates", this->trace_id, "count", end - chunk * chunk_size);
+
+            for ( c = chunk * chunk_size; c < end; ++c)
+            {
+                if ( ( this->cancellation_token && this->cancellation_token->IsCancelled() )
+                     || ( this->deadline != Limits::Clock::time_point::max()
+                          && Limits::Clock::now() >= this->deadline ) )
+                {
+                    is_interrupted = true;
+                    break;
+                }
+
+                Point* hanan = *order[ c];
+                Length length = evaluator.Evaluate( hanan->GetPosX(), hanan->GetPosY());
+
+                if ( length < current_length
+                     && length < results[ chunk].first )
+                    results[ chunk] = std::make_pair( length, c);
+
+                if ( this->progress_callback )
+                {
+                    unsigned long long done = this->evaluations + ++progress_evaluated;
+
+                    if ( done % progress_period == 0 )
+                    {
+                        std::lock_guard<std::mutex> guard( progress_lock);
+
+                        if ( done > reported )
+                        {
+                            reported = done;
+                            this->ReportProgress( done);
+                        }
+                    }
+                }
+            }
+
+            evaluated[ chunk] = c - chunk * chunk_size;
+            remaining--;
+        }, &remaining);
+    }
+
+    this->executor->WaitFor( remaining);
+
+    for ( auto it = evaluated.begin();
+          it != evaluated.end();
+          ++it)
+    {
+        this->evaluations += *it;
+    }
+
+    if ( is_interrupted )
+        this->converged = false;
+
+    /** Chunks go in order of candidates, so ties are resolved like in the serial loop */
+    std::pair<Length, std::size_t> winner( no_length, order.size());
+
+    for ( auto it = results.begin();
+          it != results.end();
+          ++it)
+    {
+        if ( it->first < winner.first )
+            winner = *it;
+    }
+
+    if ( winner.second == order.size() )
+        return false;
+
+    std::list<Point*>::iterator winner_it = order[ winner.second];
+
+    this->AddPseudoPoint( ( *winner_it)->GetPosX(), ( *winner_it)->GetPosY());
+    delete *winner_it;
+    candidates.erase( winner_it);
+    this->CalculateMST( true);
+
+    return true;
+}
+
+void SMT::SetExecutor( Executor* executor)
+{
+    this->executor = executor;
+}
+
+std::future<SMT::Length> SMT::BuildSMTAsync( Executor& executor)
+{
+    auto task = std::make_shared<std::packaged_task<Length()> >( [ this]() { return this->BuildSMT(); });
+    std::future<Length> res = task->get_future();
+
+    /** Big nets split their rounds on the same pool */
+    this->executor = &executor;
+    executor.Submit( [ task]() { ( *task)(); });
+
+    return res;
+}
+
+void SMT::BuildSMTAsync( std::function<void( Length)> callback, Executor& executor)
+{
+    this->executor = &executor;
+    executor.Submit( [ this, callback]() { callback( this->BuildSMT()); });
+}
+
+namespace
+{
+
+/** Layers of tree edges at a point */
+const unsigned char in_m2 = 1;
+const unsigned char in_m3 = 2;
+
+const unsigned char in_both = in_m2 | in_m3;
+
+/** Cost of a subtree which can't be built */
+const unsigned no_cost = std::numeric_limits<unsigned>::max();
+
+/**
+ *  Description for corners chooser
+ *
+ *  Every diagonal edge becomes an L, it goes along M3 at one end and
+ *  along M2 at the other. Chooser picks the ends over the tree so
+ *  that points need as few M2_M3 vias as possible. Each point keeps
+ *  the cheapest subtree for every layer its parent's edge can give
+ */
+class CornersChooser
+{
+
+public:
+
+    struct TreeEdge
+    {
+        unsigned point1;
+        unsigned point2;
+        bool is_diagonal;
+    };
+
+private:
+
+    const std::vector<TreeEdge>& edges;
+    const std::vector<bool>& is_pin;
+    const std::vector<unsigned char>& layers;
+
+    /** Edges of point i are at adjacent[ offsets[ i]] .. adjacent[ offsets[ i + 1] - 1] */
+    std::vector<unsigned> offsets;
+    std::vector<unsigned> adjacent;
+
+    /** cost[ point * 4 + layer from parent] */
+    std::vector<unsigned> cost;
+
+    /** choice[ edge * 4 + mask after the edge], low bits keep mask before it, bit 2 is flip */
+    std::vector<unsigned char> choice;
+    std::vector<unsigned char> best_mask;
+
+    unsigned GetViasCount( unsigned point, unsigned char mask) const
+    {
+        if ( this->is_pin[ point] )
+            return ( mask & in_m3) ? 1 : 0;
+
+        return mask == in_both ? 1 : 0;
+    }
+
+    /** Layer which the edge gives to the point, point1 is along M3 unless the edge is flipped */
+    unsigned char GetLayer( unsigned edge, unsigned point, bool is_flipped) const
+    {
+        if ( !this->edges[ edge].is_diagonal )
+            return 0;
+
+        return ( point == this->edges[ edge].point1 ) != is_flipped ? in_m3 : in_m2;
+    }
+
+    unsigned GetOther( unsigned edge, unsigned point) const
+    {
+        return this->edges[ edge].point1 == point ? this->edges[ edge].point2 : this->edges[ edge].point1;
+    }
+
+    void Evaluate( unsigned point, unsigned parent_edge)
+    {
+        unsigned masks[ 4] = { 0, no_cost, no_cost, no_cost };
+
+        for ( unsigned i = this->offsets[ point]; i < this->offsets[ point + 1]; ++i)
+        {
+            unsigned edge = this->adjacent[ i];
+            if ( edge == parent_edge )
+                continue;
+
+            unsigned child = this->GetOther( edge, point);
+            unsigned next[ 4] = { no_cost, no_cost, no_cost, no_cost };
+
+            for ( unsigned mask = 0; mask < 4; ++mask)
+            {
+                if ( masks[ mask] == no_cost )
+                    continue;
+
+                for ( unsigned flip = 0; flip < ( this->edges[ edge].is_diagonal ? 2 : 1 ); ++flip)
+                {
+                    unsigned new_mask = mask | this->GetLayer( edge, point, flip);
+                    unsigned new_cost = masks[ mask] + this->cost[ child * 4 + this->GetLayer( edge, child, flip)];
+
+                    if ( new_cost < next[ new_mask] )
+                    {
+                        next[ new_mask] = new_cost;
+                        this->choice[ edge * 4 + new_mask] = mask | ( flip << 2);
+                    }
+                }
+            }
+
+            std::copy( next, next + 4, masks);
+        }
+
+        for ( unsigned from_parent = 0; from_parent < 4; ++from_parent)
+        {
+            unsigned& best = this->cost[ point * 4 + from_parent];
+
+            for ( unsigned mask = 0; mask < 4; ++mask)
+            {
+                if ( masks[ mask] == no_cost )
+                    continue;
+
+                unsigned new_cost = masks[ mask]
+                                    + this->GetViasCount( point, this->layers[ point] | from_parent | mask);
+
+                if ( new_cost < best )
+                {
+                    best = new_cost;
+                    this->best_mask[ point * 4 + from_parent] = mask;
+                }
+            }
+        }
+    }
+
+public:
+
+    CornersChooser( const std::vector<TreeEdge>& edges,
+                    const std::vector<bool>& is_pin,
+                    const std::vector<unsigned char>& layers)
+        : edges( edges), is_pin( is_pin), layers( layers)
+    {
+    }
+
+    /** Returns for every edge if its corner has to be flipped to (x2, y1) */
+    std::vector<bool> Choose()
+    {
+        unsigned count = this->is_pin.size();
+        std::vector<bool> res( this->edges.size(), false);
+        std::vector<unsigned> order;
+        std::vector<unsigned> parent_edge( count, this->edges.size());
+        std::vector<bool> is_visited( count, false);
+
+        this->offsets.assign( count + 1, 0);
+        this->adjacent.resize( this->edges.size() * 2);
+        this->cost.assign( count * 4, no_cost);
+        this->choice.assign( this->edges.size() * 4, 0);
+        this->best_mask.assign( count * 4, 0);
+
+        for ( unsigned i = 0; i < this->edges.size(); ++i)
+        {
+            this->offsets[ this->edges[ i].point1 + 1]++;
+            this->offsets[ this->edges[ i].point2 + 1]++;
+        }
+
+        for ( unsigned i = 0; i < count; ++i)
+            this->offsets[ i + 1] += this->offsets[ i];
+
+        std::vector<unsigned> filled( this->offsets.begin(), this->offsets.end() - 1);
+
+        for ( unsigned i = 0; i < this->edges.size(); ++i)
+        {
+            this->adjacent[ filled[ this->edges[ i].point1]++] = i;
+            this->adjacent[ filled[ this->edges[ i].point2]++] = i;
+        }
+
+        /** Points are ordered parents first, so subtrees are evaluated in the reverse order */
+        for ( unsigned root = 0; root < count; ++root)
+        {
+            if ( is_visited[ root] )
+                continue;
+
+            is_visited[ root] = true;
+            order.push_back( root);
+
+            for ( unsigned i = order.size() - 1; i < order.size(); ++i)
+            {
+                unsigned point = order[ i];
+
+                for ( unsigned j = this->offsets[ point]; j < this->offsets[ point + 1]; ++j)
+                {
+                    unsigned child = this->GetOther( this->adjacent[ j], point);
+                    if ( is_visited[ child] )
+                        continue;
+
+                    is_visited[ child] = true;
+                    parent_edge[ child] = this->adjacent[ j];
+                    order.push_back( child);
+                }
+            }
+        }
+
+        for ( unsigned i = order.size(); i-- > 0; )
+            this->Evaluate( order[ i], parent_edge[ order[ i]]);
+
+        /** Layers given by parents' edges */
+        std::vector<unsigned char> from_parent( count, 0);
+
+        for ( unsigned i = 0; i < order.size(); ++i)
+        {
+            unsigned point = order[ i];
+            unsigned mask = this->best_mask[ point * 4 + from_parent[ point]];
+
+            /** Children were added to masks in adjacency order, so they are taken back in reverse */
+            for ( unsigned j = this->offsets[ point + 1]; j-- > this->offsets[ point]; )
+            {
+                unsigned edge = this->adjacent[ j];
+                if ( edge == parent_edge[ point] )
+                    continue;
+
+                unsigned char step = this->choice[ edge * 4 + mask];
+                bool is_flipped = ( step >> 2) != 0;
+
+                res[ edge] = is_flipped;
+                from_parent[ this->GetOther( edge, point)] = this->GetLayer( edge, this->GetOther( edge, point), is_flipped);
+                mask = step & 3;
+            }
+        }
+
+        return res;
+    }
+};
+
+
+}
+
+void SMT::FinalizeSMT()
+{
+    /**
+     *  Layers of every point are gathered into masks in one pass over
+     *  tree edges, then points are typed and linked once. Diagonal edges
+     *  are split at corners chosen to save vias, corners at the same
+     *  place share one via
+     */
+    typedef std::pair<Coord, Coord> Pos;
+
+    PhaseTimer timer( this->stats.finalize_time, this->stats.finalize_counters, "finalize", this->trace_id);
+    std::vector<Point*> nodes;
+    std::vector<unsigned char> layers;
+    std::vector<bool> is_pin;
+    std::vector<CornersChooser::TreeEdge> tree;
+    std::unordered_map<const Point*, unsigned> index;
+    std::unordered_map<Pos, unsigned, CoordPairHash> at_pos;
+    std::vector<unsigned> corners;
+    unsigned i = 0;
+
+    this->finalized = true;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        ( *it)->Unlink();
+        index[ *it] = i;
+        at_pos[ Pos( ( *it)->GetPosX(), ( *it)->GetPosY())] = i;
+        nodes.push_back( *it);
+        is_pin.push_back( ( *it)->IsPin());
+    }
+
+    layers.assign( nodes.size(), 0);
+
+    for ( auto it = this->existing_edges.begin();
+          it != this->existing_edges.end();
+          ++it)
+    {
+        CornersChooser::TreeEdge edge = { index[ ( *it)->GetPoint1()],
+                                          index[ ( *it)->GetPoint2()],
+                                          ( *it)->IsInBothLayers() };
+        tree.push_back( edge);
+
+        if ( edge.is_diagonal )
+            continue;
+
+        unsigned char layer = ( ( *it)->IsInM2Layer() ? in_m2 : 0 )
+                              | ( ( *it)->IsInM3Layer() ? in_m3 : 0 );
+
+        layers[ edge.point1] |= layer;
+        layers[ edge.point2] |= layer;
+    }
+
+    std::vector<bool> is_flipped = CornersChooser( tree, is_pin, layers).Choose();
+
+    for ( unsigned j = 0; j < tree.size(); ++j)
+    {
+        if ( !tree[ j].is_diagonal )
+            continue;
+
+        /** Edge goes along M3 from the first point to the corner and along M2 to the second one */
+        unsigned p1 = is_flipped[ j] ? tree[ j].point2 : tree[ j].point1;
+        unsigned p2 = is_flipped[ j] ? tree[ j].point1 : tree[ j].point2;
+        Pos pos( nodes[ p1]->GetPosX(), nodes[ p2]->GetPosY());
+        auto corner = at_pos.find( pos);
+
+        if ( corner == at_pos.end() )
+        {
+            corner = at_pos.insert( std::make_pair( pos, nodes.size())).first;
+            nodes.push_back( new Point( pos.first, pos.second, Point::M2_M3));
+            layers.push_back( 0);
+            SMT_COUNT( allocations, 1);
+        }
+
+        layers[ p1] |= in_m3;
+        layers[ p2] |= in_m2;
+        layers[ corner->second] |= in_both;
+        corners.push_back( corner->second);
+    }
+
+    for ( i = 0; i < this->num_of_points; ++i)
+    {
+        Point* point = nodes[ i];
+
+        point->FinalizeType( layers[ i] & in_m2, layers[ i] & in_m3);
+
+        if ( !point->IsPin() )
+            continue;
+
+        Point* pins_m2 = new Point( *point);
+        pins_m2->SetType( Point::Pins_M2);
+        this->existing_points.push_back( pins_m2);
+        SMT_COUNT( allocations, 1);
+
+        if ( !( layers[ i] & in_m3) )
+            continue;
+
+        Point* m2_m3 = new Point( *point);
+        m2_m3->SetType( Point::M2_M3);
+        this->existing_points.push_back( m2_m3);
+        SMT_COUNT( allocations, 1);
+    }
+
+    for ( i = this->num_of_points; i < nodes.size(); ++i)
+        this->existing_points.push_back( nodes[ i]);
+
+    auto it_corner = corners.begin();
+
+    for ( auto it = this->existing_edges.begin();
+          it != this->existing_edges.end(); )
     {
         if ( !( *it)->IsInBothLayers() )
         {
-            ++it;
+            ( *it)->FinalLink();
+            ++it;
+            continue;
+        }
+
+        Point* corner = nodes[ *it_corner++];
+
+        Edge* e1 = new Edge( ( *it)->GetPoint1(), corner, Edge::Valid);
+        Edge* e2 = new Edge( ( *it)->GetPoint2(), corner, Edge::Valid);
+
+        e1->FinalLink();
+        e2->FinalLink();
+
+        this->extra_edges.push_back( e1);
+        this->extra_edges.push_back( e2);
+        SMT_COUNT( allocations, 2);
+
+        it = this->existing_edges.erase( it);
+    }
+
+    this->MergeOverlaps();
+}
+
+namespace
+{
+
+/** Finalized edge on its track, points are ordered along the track */
+struct TrackSegment
+{
+    bool is_vertical;
+    SMT::Coord track;
+    SMT::Coord low;
+    SMT::Coord high;
+    SMT::Point* low_point;
+    SMT::Point* high_point;
+    SMT::Edge* edge;
+
+    TrackSegment( SMT::Edge* edge)
+    {
+        SMT::Point* p1 = edge->GetPoint1();
+        SMT::Point* p2 = edge->GetPoint2();
+
+        this->is_vertical = p1->GetPosX() == p2->GetPosX();
+        this->track = this->is_vertical ? p1->GetPosX() : p1->GetPosY();
+        this->low = this->is_vertical ? p1->GetPosY() : p1->GetPosX();
+        this->high = this->is_vertical ? p2->GetPosY() : p2->GetPosX();
+        this->low_point = p1;
+        this->high_point = p2;
+        this->edge = edge;
+
+        if ( this->low > this->high )
+        {
+            std::swap( this->low, this->high);
+            std::swap( this->low_point, this->high_point);
+        }
+    }
+
+    bool IsOnTrack( const TrackSegment& other) const
+    {
+        return this->is_vertical == other.is_vertical
+               && this->track == other.track;
+    }
+
+    bool operator<( const TrackSegment& other) const
+    {
+        if ( !this->IsOnTrack( other) )
+        {
+            return this->is_vertical != other.is_vertical ? !this->is_vertical
+                                                          : this->track < other.track;
+        }
+
+        return this->low < other.low;
+    }
+};
+
+}
+
+void SMT::MergeOverlaps()
+{
+    /**
+     *  L-shapes of different edges can go along the same track, so
+     *  segments are swept along tracks. Segments overlapping each other
+     *  are replaced by pieces between their ends, and the tree length
+     *  counts every piece of wire once
+     */
+    std::vector<TrackSegment> segments;
+    std::unordered_set<Edge*> merged;
+    std::list<Edge*> pieces;
+    Length length = 0;
+
+    for ( auto it = this->existing_edges.begin(); it != this->existing_edges.end(); ++it)
+        segments.push_back( TrackSegment( *it));
+
+    for ( auto it = this->extra_edges.begin(); it != this->extra_edges.end(); ++it)
+        segments.push_back( TrackSegment( *it));
+
+    std::sort( segments.begin(), segments.end());
+
+    for ( unsigned i = 0, j; i < segments.size(); i = j)
+    {
+        Coord high = segments[ i].high;
+        length += high - segments[ i].low;
+
+        for ( j = i + 1;
+              j < segments.size()
+              && segments[ j].IsOnTrack( segments[ i])
+              && segments[ j].low < high;
+              ++j)
+        {
+            if ( segments[ j].high > high )
+            {
+                length += segments[ j].high - high;
+                high = segments[ j].high;
+            }
+        }
+
+        if ( j - i == 1 )
+            continue;
+
+        std::vector<std::pair<Coord, Point*> > ends;
+
+        for ( unsigned k = i; k < j; ++k)
+        {
+            ends.push_back( std::make_pair( segments[ k].low, segments[ k].low_point));
+            ends.push_back( std::make_pair( segments[ k].high, segments[ k].high_point));
+            merged.insert( segments[ k].edge);
+        }
+
+        std::sort( ends.begin(), ends.end());
+
+        for ( unsigned k = 1; k < ends.size(); ++k)
+        {
+            if ( ends[ k].first == ends[ k - 1].first )
+                continue;
+
+            pieces.push_back( new Edge( ends[ k - 1].second, ends[ k].second, Edge::Valid));
+            SMT_COUNT( allocations, 1);
+        }
+    }
+
+    if ( this->current_MST_length != no_length )
+        this->current_MST_length = length;
+
+    if ( merged.empty() )
+        return;
+
+    /** Existing edges are owned by the list of all edges, only extra ones are deleted */
+    this->existing_edges.remove_if( [ &merged]( Edge* edge) { return merged.count( edge) != 0; });
+
+    for ( auto it = this->extra_edges.begin(); it != this->extra_edges.end(); )
+    {
+        if ( !merged.count( *it) )
+        {
+            ++it;
+            continue;
+        }
+
+        delete *it;
+        it = this->extra_edges.erase( it);
+    }
+
+    this->extra_edges.splice( this->extra_edges.end(), pieces);
+
+    for ( auto it = this->existing_points.begin(); it != this->existing_points.end(); ++it)
+        ( *it)->Unlink();
+
+    for ( auto it = this->existing_edges.begin(); it != this->existing_edges.end(); ++it)
+        ( *it)->FinalLink();
+
+    for ( auto it = this->extra_edges.begin(); it != this->extra_edges.end(); ++it)
+        ( *it)->FinalLink();
+}
+
+std::list<SMT::Point*>::iterator SMT::FindPin( Coord x, Coord y)
+{
+    unsigned i = 0;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        if ( ( *it)->IsPin()
+             && ( *it)->GetPosX() == x
+             && ( *it)->GetPosY() == y )
+            return it;
+    }
+
+    return this->existing_points.end();
+}
+
+void SMT::AddNeighboursToBox( Point* point, Box& box)
+{
+    const std::list<Edge*>& linked = point->GetEdges();
+
+    box.AddPoint( point);
+
+    for ( auto it = linked.begin();
+          it != linked.end();
+          ++it)
+    {
+        box.AddPoint( ( *it)->GetPoint1());
+        box.AddPoint( ( *it)->GetPoint2());
+    }
+}
+
+void SMT::RemoveExistingPoint( std::list<Point*>::iterator point_it)
+{
+    Point* point = *point_it;
+
+    for ( auto it = this->edges.begin();
+          it != this->edges.end(); )
+    {
+        if ( ( *it)->GetPoint1() != point
+             && ( *it)->GetPoint2() != point )
+        {
+            ++it;
+            continue;
+        }
+
+        ( *it)->GetPoint1()->Unlink( *it);
+        ( *it)->GetPoint2()->Unlink( *it);
+        this->existing_edges.remove( *it);
+
+        delete *it;
+        it = this->edges.erase( it);
+    }
+
+    delete point;
+    this->existing_points.erase( point_it);
+
+    /** Markers are paired with points by position and reset before use, so the last one goes */
+    delete this->markers.back();
+    this->markers.pop_back();
+
+    this->num_of_points--;
+}
+
+bool SMT::PruneSteinerPoints()
+{
+    /**
+     *  Steiner point of degree 2 or less never makes the tree shorter,
+     *  its neighbours can be connected directly. Degrees are taken
+     *  before any removal: edges of a removed point are deleted, so a
+     *  branching neighbour would look like a point of degree 2 after it
+     */
+    std::vector<std::list<Point*>::iterator> pruned;
+    unsigned i = 0;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        if ( !( *it)->IsPin()
+             && ( *it)->GetEdges().size() <= 2 )
+            pruned.push_back( it);
+    }
+
+    for ( auto it = pruned.begin();
+          it != pruned.end();
+          ++it)
+    {
+        this->RemoveExistingPoint( *it);
+    }
+
+    return !pruned.empty();
+}
+
+void SMT::Unfinalize()
+{
+    /** Vias and pins' copies are pushed back after first num_of_points points */
+    auto it = this->existing_points.begin();
+    for ( unsigned i = 0; i < this->num_of_points; ++i, ++it)
+    {
+        ( *it)->Unlink();
+
+        if ( !( *it)->IsPin() )
+            ( *it)->SetType( Point::Pseudo);
+    }
+
+    while ( it != this->existing_points.end() )
+    {
+        delete *it;
+        it = this->existing_points.erase( it);
+    }
+
+    this->ClearListOfPointers( this->extra_edges);
+    this->existing_edges.clear();
+
+    this->finalized = false;
+}
+
+void SMT::RepairSMT( Box& box)
+{
+    std::list<Point*> candidates;
+
+    while ( this->PruneSteinerPoints() )
+        this->CalculateMST( true);
+
+    if ( !box.IsEmpty() )
+    {
+        this->CollectLocalHananPoints( box, candidates);
+
+        this->StartIterations();
+        this->RunIterations( candidates);
+
+        this->ClearListOfPointers( candidates);
+    }
+
+    this->FinalizeSMT();
+}
+
+/**
+ * ------ Degenerate layouts ------
+ */
+
+
+namespace
+{
+
+/**
+ *  Description for two lines solver
+ *
+ *  When all pins lie on two parallel lines, optimal tree uses only
+ *  these lines and bridges between them at pins' columns. Columns are
+ *  swept in sorted order keeping the cheapest tree for every set of
+ *  line segments crossing the cut after the column
+ */
+class TwoLinesSolver
+{
+
+public:
+
+    /** Column of pins, mask has bit 0 for the low line and bit 1 for the high one */
+    struct Column
+    {
+        SMT::Coord pos;
+        unsigned mask;
+    };
+
+private:
+
+    /** Segments crossing the cut after a column */
+    enum Cut
+    {
+        /** only the low line */
+        CutLow,
+
+        /** only the high line */
+        CutHigh,
+
+        /** both lines, connected before the cut */
+        CutJoined,
+
+        /** both lines, two separate parts before the cut */
+        CutSplit,
+
+        /** nothing crosses, the tree is complete */
+        CutDone,
+
+        CutCount,
+
+        /** before the first column */
+        CutStart = CutCount
+    };
+
+    struct Choice
+    {
+        SMT::Length length;
+        unsigned prev;
+        bool bridge;
+    };
+
+    const std::vector<Column>& columns;
+    SMT::Length distance;
+    std::vector<Choice> choices;
+
+    static unsigned GetCutMask( unsigned cut)
+    {
+        switch ( cut )
+        {
+            case CutLow:
+                return 1;
+            case CutHigh:
+                return 2;
+            case CutJoined:
+            case CutSplit:
+                return 3;
+            default:
+                return 0;
+        }
+    }
+
+    /**
+     *  Checks that nothing is left behind the cut and returns the new cut,
+     *  parts 0 and 1 are lines before the column, 2 and 3 are nodes at it
+     */
+    static bool Advance( unsigned cut, unsigned mask, bool bridge, unsigned out, unsigned& next)
+    {
+        unsigned in = GetCutMask( cut);
+        unsigned part[ 4] = { 0, cut == CutSplit ? 1u : 0u, 2, 3 };
+        bool is_used[ 4];
+
+        for ( unsigned line = 0; line < 2; ++line)
+        {
+            unsigned bit = 1 << line;
+
+            is_used[ line] = ( in & bit) != 0;
+            is_used[ 2 + line] = ( ( in | out | mask) & bit) || bridge;
+
+            if ( in & bit )
+                part[ 2 + line] = part[ line];
+        }
+
+        if ( bridge )
+        {
+            unsigned low = part[ 2];
+            for ( unsigned i = 0; i < 4; ++i)
+            {
+                if ( part[ i] == low )
+                    part[ i] = part[ 3];
+            }
+        }
+
+        /** Every used part goes on through the cut, or the tree is complete */
+        for ( unsigned i = 0; i < 4; ++i)
+        {
+            if ( !is_used[ i] )
+                continue;
+
+            bool is_passed = ( ( out & 1) && part[ i] == part[ 2] )
+                             || ( ( out & 2) && part[ i] == part[ 3] );
+
+            if ( !out )
+                is_passed = part[ i] == part[ is_used[ 2] ? 2 : 3];
+
+            if ( !is_passed )
+                return false;
+        }
+
+        switch ( out )
+        {
+            case 0:
+                next = CutDone;
+                break;
+            case 1:
+                next = CutLow;
+                break;
+            case 2:
+                next = CutHigh;
+                break;
+            default:
+                next = part[ 2] == part[ 3] ? CutJoined : CutSplit;
+        }
+
+        return true;
+    }
+
+    Choice& GetChoice( unsigned column, unsigned cut)
+    {
+        return this->choices[ column * CutCount + cut];
+    }
+
+public:
+
+    TwoLinesSolver( const std::vector<Column>& columns, SMT::Length distance)
+        : columns( columns)
+    {
+        this->distance = distance;
+    }
+
+    /** Returns nodes where a bridge meets a line going both ways, they are Steiner points */
+    std::vector<std::pair<SMT::Coord, unsigned> > Solve()
+    {
+        std::vector<std::pair<SMT::Coord, unsigned> > res;
+        unsigned count = this->columns.size();
+        Choice none = { SMT::no_length, CutStart, false };
+
+        this->choices.assign( count * CutCount, none);
+
+        for ( unsigned i = 0; i < count; ++i)
+        {
+            SMT::Length gap = i + 1 < count ? this->columns[ i + 1].pos - this->columns[ i].pos : 0;
+
+            for ( unsigned cut = 0; cut <= CutCount; ++cut)
+            {
+                if ( ( cut == CutStart ) != ( i == 0 )
+                     || cut == CutDone )
+                    continue;
+
+                SMT::Length length = cut == CutStart ? 0 : this->GetChoice( i - 1, cut).length;
+                if ( length == SMT::no_length )
+                    continue;
+
+                for ( unsigned bridge = 0; bridge < 2; ++bridge)
+                {
+                    /** Nothing is left after the last column */
+                    for ( unsigned out = 0; out < ( i + 1 < count ? 4 : 1 ); ++out)
+                    {
+                        unsigned next;
+                        if ( ( out == 0 ) != ( i + 1 == count )
+                             || !Advance( cut, this->columns[ i].mask, bridge, out, next) )
+                            continue;
+
+                        SMT::Length new_length = length
+                                                 + ( bridge ? this->distance : 0 )
+                                                 + ( ( out & 1) ? gap : 0 )
+                                                 + ( ( out & 2) ? gap : 0 );
+
+                        Choice& choice = this->GetChoice( i, next);
+                        if ( new_length < choice.length )
+                        {
+                            choice.length = new_length;
+                            choice.prev = cut;
+                            choice.bridge = bridge;
+                        }
+                    }
+                }
+            }
+        }
+
+        unsigned cut = CutDone;
+        for ( unsigned i = count; i-- > 0; )
+        {
+            const Choice& choice = this->GetChoice( i, cut);
+            unsigned in = GetCutMask( choice.prev);
+            unsigned out = GetCutMask( cut);
+
+            for ( unsigned line = 0; line < 2; ++line)
+            {
+                unsigned bit = 1 << line;
+                if ( choice.bridge
+                     && ( in & bit)
+                     && ( out & bit)
+                     && !( this->columns[ i].mask & bit) )
+                    res.push_back( std::make_pair( this->columns[ i].pos, line));
+            }
+
+            cut = choice.prev;
+        }
+
+        return res;
+    }
+};
+
+}
+
+void SMT::RemoveSteinerPoints()
+{
+    unsigned i = 0;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points; )
+    {
+        if ( ( *it)->IsPin() )
+        {
+            ++it, ++i;
             continue;
         }
 
-        unsigned x = ( *it)->GetPosX1();
-        unsigned y = ( *it)->GetPosY2();
+        auto next = it;
+        ++next;
 
-        Point* m2_m3 = new Point( x, y, Point::M2_M3);
-        Point* p1 = ( *it)->GetPoint1();
-        Point* p2 = ( *it)->GetPoint2();
+        this->RemoveExistingPoint( it);
+        it = next;
+    }
+}
 
-        bool p1_was_in_m3 = p1->IsInM3Layer();
-        bool p2_was_in_m3 = p2->IsInM3Layer();
+bool SMT::SolveDegenerateLayout()
+{
+    /**
+     *  Pins on one line are connected by MST along it and pins on two
+     *  parallel lines are solved exactly, so 1-Steiner iterations
+     *  are left only for general layouts
+     */
+    std::vector<Coord> xs;
+    std::vector<Coord> ys;
+    unsigned i = 0;
 
-        Edge* e1 = new Edge( p1, m2_m3, Edge::Valid);
-        Edge* e2 = new Edge( p2, m2_m3, Edge::Valid);
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        if ( !( *it)->IsPin() )
+            continue;
 
-        p1->Unlink( *it);
-        p2->Unlink( *it);
-        e1->FinalLink();
-        e2->FinalLink();
+        xs.push_back( ( *it)->GetPosX());
+        ys.push_back( ( *it)->GetPosY());
+    }
+
+    std::vector<Coord> lines_x( xs);
+    std::vector<Coord> lines_y( ys);
+
+    std::sort( lines_x.begin(), lines_x.end());
+    lines_x.erase( std::unique( lines_x.begin(), lines_x.end()), lines_x.end());
+    std::sort( lines_y.begin(), lines_y.end());
+    lines_y.erase( std::unique( lines_y.begin(), lines_y.end()), lines_y.end());
+
+    if ( lines_x.size() > 2
+         && lines_y.size() > 2 )
+        return false;
+
+    /** Seeds can only make such trees longer */
+    this->RemoveSteinerPoints();
+
+    if ( lines_x.size() > 1
+         && lines_y.size() > 1 )
+    {
+        /** Lines go along the axis with more distinct coordinates */
+        bool is_horizontal = lines_y.size() == 2;
+        const std::vector<Coord>& lines = is_horizontal ? lines_y : lines_x;
+        const std::vector<Coord>& along = is_horizontal ? xs : ys;
+        const std::vector<Coord>& across = is_horizontal ? ys : xs;
+
+        std::vector<std::pair<Coord, unsigned> > pins;
+        std::vector<TwoLinesSolver::Column> columns;
+
+        for ( unsigned j = 0; j < along.size(); ++j)
+            pins.push_back( std::make_pair( along[ j], across[ j] == lines[ 0] ? 1u : 2u ));
+
+        std::sort( pins.begin(), pins.end());
 
-        if ( !p1_was_in_m3 && p1->IsInM3Layer() )
+        for ( auto it = pins.begin(); it != pins.end(); ++it)
         {
-            Point* m2_m3_2 = new Point( p1->GetPosX(), p1->GetPosY(), Point::M2_M3);
-            this->existing_points.push_back( m2_m3_2);
+            if ( columns.empty()
+                 || columns.back().pos != it->first )
+            {
+                TwoLinesSolver::Column column = { it->first, 0 };
+                columns.push_back( column);
+            }
+
+            columns.back().mask |= it->second;
         }
 
-        if ( !p2_was_in_m3 && p2->IsInM3Layer() )
+        TwoLinesSolver solver( columns, lines[ 1] - lines[ 0]);
+        auto steiner_points = solver.Solve();
+
+        for ( auto it = steiner_points.begin(); it != steiner_points.end(); ++it)
         {
-            Point* m2_m3_2 = new Point( p2->GetPosX(), p2->GetPosY(), Point::M2_M3);
-            this->existing_points.push_back( m2_m3_2);
+            Coord pos = lines[ it->second];
+
+            if ( is_horizontal )
+                this->AddPseudoPoint( it->first, pos);
+            else
+                this->AddPseudoPoint( pos, it->first);
         }
+    }
 
-        this->existing_points.push_back( m2_m3);
+    this->CalculateMST( true);
 
-        this->extra_edges.push_back( e1);
-        this->extra_edges.push_back( e2);
+    return true;
+}
 
-        it = this->existing_edges.erase( it);
+void SMT::StartIterations()
+{
+    this->converged = true;
+    this->iterations = 0;
+    this->evaluations = 0;
+    this->deadline = this->limits.GetDeadline( Limits::Clock::now());
+}
+
+bool SMT::IsOutOfLimits()
+{
+    unsigned max_iterations = this->limits.GetMaxIterations();
+    unsigned long long max_evaluations = this->limits.GetMaxEvaluations();
+
+    if ( max_iterations
+         && this->iterations >= max_iterations )
+        return true;
+
+    if ( max_evaluations
+         && this->evaluations >= max_evaluations )
+        return true;
+
+    if ( this->cancellation_token
+         && this->cancellation_token->IsCancelled() )
+        return true;
+
+    return this->deadline != Limits::Clock::time_point::max()
+           && Limits::Clock::now() >= this->deadline;
+}
+
+void SMT::RunIterations( std::list<Point*>& candidates)
+{
+    PhaseTimer timer( this->stats.iterations_time, this->stats.iterations_counters, "iterations", this->trace_id);
+
+    while ( true )
+    {
+        if ( this->IsOutOfLimits() )
+        {
+            this->converged = false;
+            break;
+        }
+
+        Tracer::Scope scope( "round", this->trace_id, "round", this->iterations + 1);
+        SMT_COUNT( attempted_rounds, 1);
+
+        if ( !this->SMTIteration( candidates) )
+            break;
+
+        this->iterations++;
+
+        if ( this->progress_callback )
+            this->ReportProgress( this->evaluations);
     }
+
+    SMT_COUNT( rounds, this->iterations);
+    SMT_COUNT( evaluations, this->evaluations);
+}
+
+void SMT::ReportProgress( unsigned long long evaluations)
+{
+    Progress progress;
+
+    progress.round = this->iterations + 1;
+    progress.length = this->current_MST_length;
+    progress.evaluations = evaluations;
+
+    this->progress_callback( progress);
+}
+
+void SMT::SetCancellationToken( CancellationToken* token)
+{
+    this->cancellation_token = token;
+}
+
+void SMT::SetProgressCallback( const ProgressCallback& callback)
+{
+    this->progress_callback = callback;
+}
+
+void SMT::SetLimits( const Limits& limits)
+{
+    this->limits = limits;
+}
+
+bool SMT::IsConverged() const
+{
+    return this->converged;
+}
+
+const SMT::Stats& SMT::GetStats() const
+{
+    return this->stats;
+}
+
+void SMT::ResetStats()
+{
+    this->stats = Stats();
+}
+
+void SMT::SetTraceId( unsigned long long id)
+{
+    this->trace_id = id;
 }
 
-unsigned SMT::BuildSMT()
+SMT::Length SMT::BuildSMT()
 {
     if ( this->finalized )
         return this->current_MST_length;
 
+    Tracer::Scope scope( "BuildSMT", this->trace_id);
+
+    /** Time limit counts from here, Hanan points and first MST are a part of it */
+    this->StartIterations();
+
+    bool is_degenerate;
+
+    {
+        PhaseTimer timer( this->stats.mst_time, this->stats.mst_counters, "mst", this->trace_id);
+        is_degenerate = this->SolveDegenerateLayout();
+    }
+
+    if ( is_degenerate )
+    {
+        this->FinalizeSMT();
+        return this->current_MST_length;
+    }
+
     this->CollectHananPoints();
-    this->CalculateMST( true);
 
-    while( this->SMTIteration());
+    {
+        PhaseTimer timer( this->stats.mst_time, this->stats.mst_counters, "mst", this->trace_id);
+        this->CalculateMST( true);
+
+        /** Seeds which don't branch the tree anymore are dropped before iterations */
+        while ( this->PruneSteinerPoints() )
+            this->CalculateMST( true);
+    }
+
+    this->RunIterations( this->hanan_points);
+
+    this->FinalizeSMT();
+
+    return this->current_MST_length;
+}
+
+SMT::Length SMT::BuildSMTFromSeeds( bool is_converged)
+{
+    /** Seeds are taken as they are, so there is no need in Hanan points and iterations */
+    if ( this->finalized )
+        return this->current_MST_length;
+
+    Tracer::Scope scope( "BuildSMTFromSeeds", this->trace_id);
+    this->converged = is_converged;
+
+    {
+        PhaseTimer timer( this->stats.mst_time, this->stats.mst_counters, "mst", this->trace_id);
+        this->CalculateMST( true);
+
+        while ( this->PruneSteinerPoints() )
+            this->CalculateMST( true);
+    }
 
     this->FinalizeSMT();
 
     return this->current_MST_length;
 }
 
-std::list<SMT::Point> SMT::GetPointsList()
+std::list<SMT::Point> SMT::GetPointsList() const
 {
     return this->MakeSafeCopyForListOfPointers( this->existing_points);
 }
 
-std::list<SMT::Edge> SMT::GetEdgesList()
+std::list<SMT::Edge> SMT::GetEdgesList() const
 {
     auto res = this->MakeSafeCopyForListOfPointers( this->existing_edges);
     res.splice( res.begin(), this->MakeSafeCopyForListOfPointers( this->extra_edges));
     return res;
 }
 
+std::list<SMT::Point> SMT::GetSteinerPoints() const
+{
+    /** Steiner points are the first num_of_points points which are not pins */
+    std::list<Point> res;
+    unsigned i = 0;
+
+    for ( auto it = this->existing_points.begin();
+          i < this->num_of_points;
+          ++it, ++i)
+    {
+        if ( !( *it)->IsPin() )
+            res.push_back( Point( **it));
+    }
+
+    return res;
+}
+
+SMT::PointsView SMT::GetPoints() const
+{
+    return PointsView( this->existing_points);
+}
+
+SMT::EdgesView SMT::GetEdges() const
+{
+    /** Same order as GetEdgesList: extra edges go first */
+    return EdgesView( this->extra_edges, this->existing_edges);
+}
+
 void SMT::Destroy()
 {
     this->ClearListOfPointers( this->existing_points);
@@ -744,6 +2559,9 @@ void SMT::Destroy()
     this->ClearListOfPointers( this->edges);
     this->ClearListOfPointers( this->markers);
     this->ClearListOfPointers( this->extra_edges);
+
+    /** Existing edges are owned by edges list */
+    this->existing_edges.clear();
 }
 
 template<typename T> std::list<T*> SMT::DuplicateListOfPointers( const std::list<T*>& to_copy)
@@ -760,7 +2578,7 @@ template<typename T> std::list<T*> SMT::DuplicateListOfPointers( const std::list
     return dest;
 }
 
-template<typename T> std::list<T> SMT::MakeSafeCopyForListOfPointers( const std::list<T*>& to_copy)
+template<typename T> std::list<T> SMT::MakeSafeCopyForListOfPointers( const std::list<T*>& to_copy) const
 {
     std::list<T> dest;
 
@@ -788,35 +2606,162 @@ template<typename T> void SMT::ClearListOfPointers( std::list<T*>& to_clear)
 
 void SMT::PerformCopy( const SMT& other)
 {
-    this->grid_size = other.grid_size;
+    /**
+     *  Copy is made structurally: every point and edge is duplicated once
+     *  and pointers are remapped, so we neither regenerate edges nor
+     *  recalculate MST, and finalized trees keep their vias and segments
+     */
+    std::unordered_map<const Point*, Point*> point_map;
+    std::unordered_map<const Edge*, Edge*> edge_map;
+
+    point_map.reserve( other.existing_points.size());
+    edge_map.reserve( other.edges.size() + other.extra_edges.size());
+
+    this->width = other.width;
+    this->height = other.height;
     this->pin_count = other.pin_count;
-    this->num_of_points = 0;
-    this->current_MST_length = -1;
+    this->num_of_points = other.num_of_points;
+    this->current_MST_length = other.current_MST_length;
+    this->finalized = other.finalized;
+    this->converged = other.converged;
+    this->limits = other.limits;
+    this->cancellation_token = other.cancellation_token;
+    this->progress_callback = other.progress_callback;
+    this->executor = other.executor;
+    this->iterations = 0;
+    this->evaluations = 0;
+    this->stats = other.stats;
+    this->trace_id = other.trace_id;
 
-    this->finalized = false;
-    unsigned i = 0;
+    for ( auto it = other.existing_points.begin();
+          it != other.existing_points.end();
+          ++it)
+    {
+        Point* point = new Point( **it);
+        point_map[ *it] = point;
+        this->existing_points.push_back( point);
+    }
+
+    /** Markers belong to the first num_of_points points, they are reset before every use */
+    auto it_point = this->existing_points.begin();
+
+    for ( auto it = other.markers.begin();
+          it != other.markers.end();
+          ++it, ++it_point)
+    {
+        Marker* marker = new Marker( **it);
+        marker->InitByPoint( *it_point);
+        this->markers.push_back( marker);
+    }
+
+    for ( auto it = other.edges.begin();
+          it != other.edges.end();
+          ++it)
+    {
+        Edge* edge = new Edge( **it, point_map[ ( *it)->GetPoint1()], point_map[ ( *it)->GetPoint2()]);
+        edge_map[ *it] = edge;
+        this->edges.push_back( edge);
+    }
+
+    for ( auto it = other.extra_edges.begin();
+          it != other.extra_edges.end();
+          ++it)
+    {
+        Edge* edge = new Edge( **it, point_map[ ( *it)->GetPoint1()], point_map[ ( *it)->GetPoint2()]);
+        edge_map[ *it] = edge;
+        this->extra_edges.push_back( edge);
+    }
+
+    for ( auto it = other.existing_edges.begin();
+          it != other.existing_edges.end();
+          ++it)
+    {
+        this->existing_edges.push_back( edge_map[ *it]);
+    }
+
+    it_point = this->existing_points.begin();
 
     for ( auto it = other.existing_points.begin();
-          i < other.num_of_points;
-          ++it, ++i)
+          it != other.existing_points.end();
+          ++it, ++it_point)
     {
-        this->AddExistingPoint( ( *it)->GetPosX(), ( *it)->GetPosY(), ( *it)->GetType(), Edge::Valid);
+        const std::list<Edge*>& linked = ( *it)->GetEdges();
+
+        for ( auto it_edge = linked.begin();
+              it_edge != linked.end();
+              ++it_edge)
+        {
+            ( *it_point)->Link( edge_map[ *it_edge]);
+        }
     }
 
     this->hanan_points = this->DuplicateListOfPointers( other.hanan_points);
+}
 
-    this->CalculateMST( true);
+void SMT::PerformMove( SMT& other)
+{
+    /** Points, edges and markers stay where they are, we only take the lists */
+    this->existing_points = std::move( other.existing_points);
+    this->hanan_points = std::move( other.hanan_points);
+    this->edges = std::move( other.edges);
+    this->existing_edges = std::move( other.existing_edges);
+    this->markers = std::move( other.markers);
+    this->extra_edges = std::move( other.extra_edges);
+
+    this->width = other.width;
+    this->height = other.height;
+    this->pin_count = other.pin_count;
+    this->num_of_points = other.num_of_points;
+    this->current_MST_length = other.current_MST_length;
+    this->finalized = other.finalized;
+    this->converged = other.converged;
+    this->limits = other.limits;
+    this->cancellation_token = other.cancellation_token;
+    this->progress_callback = std::move( other.progress_callback);
+    this->executor = other.executor;
+    this->iterations = 0;
+    this->evaluations = 0;
+    this->stats = other.stats;
+    this->trace_id = other.trace_id;
+
+    /** Moved-from SMT is left empty, so it can be destroyed or reused */
+    other.existing_points.clear();
+    other.hanan_points.clear();
+    other.edges.clear();
+    other.existing_edges.clear();
+    other.markers.clear();
+    other.extra_edges.clear();
+
+    other.num_of_points = 0;
+    other.current_MST_length = no_length;
+    other.finalized = false;
+    other.converged = false;
+}
+
+SMT::SMT( Coord N,
+          unsigned M)
+    : SMT( N, N, M)
+{
 }
 
-SMT::SMT( unsigned N,
+SMT::SMT( Coord width,
+          Coord height,
           unsigned M)
 {
-    this->grid_size = N;
+    this->width = width;
+    this->height = height;
     this->pin_count = M;
     this->num_of_points = 0;
-    this->current_MST_length = -1;
+    this->current_MST_length = no_length;
 
     this->finalized = false;
+    this->converged = false;
+    this->cancellation_token = nullptr;
+    this->executor = nullptr;
+    this->iterations = 0;
+    this->evaluations = 0;
+    this->stats = Stats();
+    this->trace_id = 0;
 }
 
 SMT::~SMT()
@@ -829,8 +2774,16 @@ SMT::SMT( const SMT& other)
     this->PerformCopy( other);
 }
 
+SMT::SMT( SMT&& other_tmp)
+{
+    this->PerformMove( other_tmp);
+}
+
 SMT& SMT::operator=( const SMT& other)
 {
+    if ( this == &other )
+        return *this;
+
     this->Destroy();
 
     this->PerformCopy( other);
@@ -840,9 +2793,12 @@ SMT& SMT::operator=( const SMT& other)
 
 SMT& SMT::operator=( SMT&& other_tmp)
 {
+    if ( this == &other_tmp )
+        return *this;
+
     this->Destroy();
 
-    *this = other_tmp;
+    this->PerformMove( other_tmp);
 
     return *this;
 }
@@ -0,0 +1,358 @@
+#include "smt_cache.h"
+#include <string.h>
+#include <algorithm>
+#include <utility>
+
+/**
+ * ------ SMTCache::Canonical ------
+ */
+
+
+SMTCache::Canonical::Canonical( SMT& smt)
+{
+    std::vector<std::pair<SMT::Coord, SMT::Coord> > pins;
+    SMT::PointsView points = smt.GetPoints();
+
+    pins.reserve( points.size());
+
+    for ( auto it = points.begin();
+          it != points.end();
+          ++it)
+    {
+        if ( it->IsPin() )
+            pins.push_back( std::make_pair( it->GetPosX(), it->GetPosY()));
+    }
+
+    this->min_x = this->min_y = 0;
+    this->width = this->height = 0;
+    this->transform = 0;
+
+    if ( !pins.empty() )
+    {
+        SMT::Coord max_x = pins[ 0].first;
+        SMT::Coord max_y = pins[ 0].second;
+
+        this->min_x = max_x;
+        this->min_y = max_y;
+
+        for ( auto it = pins.begin();
+              it != pins.end();
+              ++it)
+        {
+            this->min_x = std::min( this->min_x, it->first);
+            this->min_y = std::min( this->min_y, it->second);
+            max_x = std::max( max_x, it->first);
+            max_y = std::max( max_y, it->second);
+        }
+
+        this->width = max_x - this->min_x;
+        this->height = max_y - this->min_y;
+    }
+
+    std::vector<std::pair<SMT::Coord, SMT::Coord> > transformed( pins.size());
+    std::vector<SMT::Coord> candidate;
+    unsigned best = 0;
+
+    for ( unsigned t = 0; t < 8; ++t)
+    {
+        this->transform = t;
+
+        for ( std::size_t i = 0; i < pins.size(); ++i)
+        {
+            this->ToCanonical( pins[ i].first, pins[ i].second,
+                               transformed[ i].first, transformed[ i].second);
+        }
+
+        std::sort( transformed.begin(), transformed.end());
+
+        candidate.clear();
+        for ( auto it = transformed.begin();
+              it != transformed.end();
+              ++it)
+        {
+            candidate.push_back( it->first);
+            candidate.push_back( it->second);
+        }
+
+        if ( t == 0
+             || candidate < this->key )
+        {
+            this->key.swap( candidate);
+            best = t;
+        }
+    }
+
+    this->transform = best;
+}
+
+std::vector<SMT::Coord>& SMTCache::Canonical::GetKey()
+{
+    return this->key;
+}
+
+void SMTCache::Canonical::ToCanonical( SMT::Coord x, SMT::Coord y, SMT::Coord& u, SMT::Coord& v)
+{
+    u = x - this->min_x;
+    v = y - this->min_y;
+
+    /** Mirroring is done in original axes, then axes can be swapped */
+    if ( this->transform & 1 )
+        u = this->width - u;
+
+    if ( this->transform & 2 )
+        v = this->height - v;
+
+    if ( this->transform & 4 )
+        std::swap( u, v);
+}
+
+void SMTCache::Canonical::FromCanonical( SMT::Coord u, SMT::Coord v, SMT::Coord& x, SMT::Coord& y)
+{
+    if ( this->transform & 4 )
+        std::swap( u, v);
+
+    if ( this->transform & 2 )
+        v = this->height - v;
+
+    if ( this->transform & 1 )
+        u = this->width - u;
+
+    x = u + this->min_x;
+    y = v + this->min_y;
+}
+
+
+/**
+ * ------ SMTCache ------
+ */
+
+
+std::size_t SMTCache::KeyHash::operator()( const std::vector<SMT::Coord>& key) const
+{
+    /** FNV-1a over coordinates */
+    unsigned long long hash = 14695981039346656037ull;
+
+    for ( auto it = key.begin();
+          it != key.end();
+          ++it)
+    {
+        hash ^= *it;
+        hash *= 1099511628211ull;
+    }
+
+    return static_cast<std::size_t>( hash);
+}
+
+SMTCache::SMTCache( std::size_t capacity, unsigned shards_count)
+    : shards( shards_count ? shards_count : 1)
+{
+    this->shard_capacity = capacity / this->shards.size();
+    if ( !this->shard_capacity )
+        this->shard_capacity = 1;
+
+    this->disk_cache = nullptr;
+
+    this->hits = 0;
+    this->misses = 0;
+    this->evictions = 0;
+}
+
+SMTCache& SMTCache::GetInstance()
+{
+    static SMTCache instance( default_capacity);
+    return instance;
+}
+
+SMTCache::Shard& SMTCache::GetShard( const std::vector<SMT::Coord>& key)
+{
+    /** Low bits of the hash select the bucket inside a shard, so mix in the high ones */
+    std::size_t hash = KeyHash()( key);
+    return this->shards[ ( hash ^ ( hash >> 16)) % this->shards.size()];
+}
+
+void SMTCache::SetDiskCache( DiskCache* disk_cache, const std::string& key_prefix)
+{
+    this->disk_cache = disk_cache;
+    this->disk_key_prefix = key_prefix;
+}
+
+std::string SMTCache::MakeDiskKey( const std::vector<SMT::Coord>& key)
+{
+    std::string disk_key( this->disk_key_prefix);
+
+    disk_key.append( reinterpret_cast<const char*>( key.data()), key.size() * sizeof( SMT::Coord));
+
+    return disk_key;
+}
+
+bool SMTCache::FindOnDisk( const std::vector<SMT::Coord>& key, std::vector<SMT::Coord>& steiner_points)
+{
+    std::string value;
+
+    if ( !this->disk_cache
+         || !this->disk_cache->Find( this->MakeDiskKey( key), value)
+         || value.size() % ( 2 * sizeof( SMT::Coord)) )
+        return false;
+
+    steiner_points.resize( value.size() / sizeof( SMT::Coord));
+
+    if ( !value.empty() )
+        memcpy( &steiner_points[ 0], value.data(), value.size());
+
+    return true;
+}
+
+bool SMTCache::Find( const std::vector<SMT::Coord>& key, std::vector<SMT::Coord>& steiner_points)
+{
+    Shard& shard = this->GetShard( key);
+    std::lock_guard<std::mutex> guard( shard.lock);
+
+    auto found = shard.index.find( key);
+    if ( found == shard.index.end() )
+        return false;
+
+    shard.entries.splice( shard.entries.begin(), shard.entries, found->second);
+    steiner_points = found->second->steiner_points;
+
+    return true;
+}
+
+void SMTCache::Insert( std::vector<SMT::Coord>& key, std::vector<SMT::Coord>& steiner_points)
+{
+    Shard& shard = this->GetShard( key);
+    std::lock_guard<std::mutex> guard( shard.lock);
+
+    auto found = shard.index.find( key);
+    if ( found != shard.index.end() )
+    {
+        /** Another thread has built the same net meanwhile */
+        shard.entries.splice( shard.entries.begin(), shard.entries, found->second);
+        return;
+    }
+
+    shard.entries.push_front( Entry());
+    shard.entries.front().key = key;
+    shard.entries.front().steiner_points.swap( steiner_points);
+    shard.index[ shard.entries.front().key] = shard.entries.begin();
+
+    while ( shard.entries.size() > this->shard_capacity )
+    {
+        shard.index.erase( shard.entries.back().key);
+        shard.entries.pop_back();
+        this->evictions++;
+    }
+}
+
+SMT::Length SMTCache::BuildSMT( SMT& smt)
+{
+    Canonical canonical( smt);
+    std::vector<SMT::Coord> steiner_points;
+
+    bool is_found = this->Find( canonical.GetKey(), steiner_points);
+
+    /** Entry from disk goes to memory as well, the copy keeps steiner_points */
+    if ( !is_found
+         && this->FindOnDisk( canonical.GetKey(), steiner_points) )
+    {
+        std::vector<SMT::Coord> entry( steiner_points);
+
+        this->Insert( canonical.GetKey(), entry);
+        is_found = true;
+    }
+
+    if ( is_found )
+    {
+        this->hits++;
+
+        for ( std::size_t i = 0; i + 1 < steiner_points.size(); i += 2)
+        {
+            SMT::Coord x, y;
+            canonical.FromCanonical( steiner_points[ i], steiner_points[ i + 1], x, y);
+            smt.AddSteinerPoint( x, y);
+        }
+
+        /** Only converged builds are cached */
+        return smt.BuildSMTFromSeeds( true);
+    }
+
+    this->misses++;
+
+    SMT::Length length = smt.BuildSMT();
+
+    /** Build stopped by limits would give its tree to every later net of the pattern */
+    if ( !smt.IsConverged() )
+        return length;
+
+    std::list<SMT::Point> built = smt.GetSteinerPoints();
+
+    for ( auto it = built.begin();
+          it != built.end();
+          ++it)
+    {
+        SMT::Coord u, v;
+        canonical.ToCanonical( it->GetPosX(), it->GetPosY(), u, v);
+        steiner_points.push_back( u);
+        steiner_points.push_back( v);
+    }
+
+    if ( this->disk_cache )
+    {
+        this->disk_cache->Append( this->MakeDiskKey( canonical.GetKey()),
+                                  std::string( reinterpret_cast<const char*>( steiner_points.data()),
+                                               steiner_points.size() * sizeof( SMT::Coord)));
+    }
+
+    this->Insert( canonical.GetKey(), steiner_points);
+
+    return length;
+}
+
+void SMTCache::Clear()
+{
+    for ( auto it = this->shards.begin();
+          it != this->shards.end();
+          ++it)
+    {
+        std::lock_guard<std::mutex> guard( it->lock);
+        it->index.clear();
+        it->entries.clear();
+    }
+}
+
+unsigned long long SMTCache::GetHits()
+{
+    return this->hits;
+}
+
+unsigned long long SMTCache::GetMisses()
+{
+    return this->misses;
+}
+
+unsigned long long SMTCache::GetEvictions()
+{
+    return this->evictions;
+}
+
+double SMTCache::GetHitRate()
+{
+    unsigned long long hits = this->hits;
+    unsigned long long total = hits + this->misses;
+
+    return total ? static_cast<double>( hits) / total : 0;
+}
+
+std::size_t SMTCache::GetSize()
+{
+    std::size_t size = 0;
+
+    for ( auto it = this->shards.begin();
+          it != this->shards.end();
+          ++it)
+    {
+        std::lock_guard<std::mutex> guard( it->lock);
+        size += it->entries.size();
+    }
+
+    return size;
+}
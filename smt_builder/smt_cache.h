@@ -0,0 +1,127 @@
+#ifndef SMT__SMT_CACHE_H
+#define SMT__SMT_CACHE_H
+
+#include "smt.h"
+#include "disk_cache.h"
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ *  Description for SMT cache
+ *
+ *  Cache keeps Steiner points of built nets in a canonical form, so
+ *  nets which have the same pins up to translation, mirroring or
+ *  rotation by 90 degrees share one entry. On a hit Steiner points
+ *  are transformed back and SMT is built from them without 1-Steiner
+ *  iterations, layers are assigned for the real orientation. Builds
+ *  stopped by limits aren't cached, so every entry is a converged one.
+ *
+ *  Cache is split into shards with own lock and LRU list, so threads
+ *  mostly don't wait for each other. With a disk cache set, entries
+ *  missing in memory are looked up there and new ones are appended,
+ *  so patterns are shared between builder processes
+ */
+class SMTCache
+{
+
+private:
+
+    /**
+     *  Description for canonical form
+     *
+     *  Key is made of sorted pins coordinates after translation to
+     *  the origin and the smallest of 8 transformations
+     */
+    class Canonical
+    {
+
+    private:
+
+        std::vector<SMT::Coord> key;
+        unsigned transform;
+        SMT::Coord min_x;
+        SMT::Coord min_y;
+        SMT::Coord width;
+        SMT::Coord height;
+
+    public:
+
+        Canonical( SMT& smt);
+
+        std::vector<SMT::Coord>& GetKey();
+
+        void ToCanonical( SMT::Coord x, SMT::Coord y, SMT::Coord& u, SMT::Coord& v);
+        void FromCanonical( SMT::Coord u, SMT::Coord v, SMT::Coord& x, SMT::Coord& y);
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()( const std::vector<SMT::Coord>& key) const;
+    };
+
+    struct Entry
+    {
+        std::vector<SMT::Coord> key;
+
+        /** Steiner points in canonical coordinates, x and y by turns */
+        std::vector<SMT::Coord> steiner_points;
+    };
+
+    typedef std::list<Entry> LRUList;
+
+    struct Shard
+    {
+        std::mutex lock;
+
+        /** Most recently used entries go first */
+        LRUList entries;
+        std::unordered_map<std::vector<SMT::Coord>, LRUList::iterator, KeyHash> index;
+    };
+
+    std::vector<Shard> shards;
+    std::size_t shard_capacity;
+
+    std::atomic<unsigned long long> hits;
+    std::atomic<unsigned long long> misses;
+    std::atomic<unsigned long long> evictions;
+
+    DiskCache* disk_cache;
+    std::string disk_key_prefix;
+
+    Shard& GetShard( const std::vector<SMT::Coord>& key);
+    std::string MakeDiskKey( const std::vector<SMT::Coord>& key);
+    bool FindOnDisk( const std::vector<SMT::Coord>& key, std::vector<SMT::Coord>& steiner_points);
+    bool Find( const std::vector<SMT::Coord>& key, std::vector<SMT::Coord>& steiner_points);
+    void Insert( std::vector<SMT::Coord>& key, std::vector<SMT::Coord>& steiner_points);
+
+public:
+
+    /** Default entries count for the process-wide cache */
+    static const std::size_t default_capacity = 1 << 16;
+    static const unsigned default_shards_count = 16;
+
+    SMTCache( std::size_t capacity, unsigned shards_count = default_shards_count);
+    SMTCache( const SMTCache& other) = delete;
+    SMTCache& operator=( const SMTCache& other) = delete;
+
+    static SMTCache& GetInstance();
+
+    /** Prefix keeps keys apart from other records and holds solver version */
+    void SetDiskCache( DiskCache* disk_cache, const std::string& key_prefix);
+
+    SMT::Length BuildSMT( SMT& smt);
+    void Clear();
+
+    unsigned long long GetHits();
+    unsigned long long GetMisses();
+    unsigned long long GetEvictions();
+    double GetHitRate();
+    std::size_t GetSize();
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "solution_checker.h"
+
+/**
+ * ------ SolutionChecker ------
+ */
+
+
+std::size_t SolutionChecker::NodeHash::operator()( const Node& node) const
+{
+    unsigned long long hash = static_cast<unsigned long long>( node.x) * 0x9E3779B97F4A7C15ull;
+
+    hash ^= node.y + ( hash >> 29);
+    hash = hash * Layers + node.layer;
+
+    return static_cast<std::size_t>( hash);
+}
+
+unsigned SolutionChecker::GetId( SMT::Coord x, SMT::Coord y, unsigned layer)
+{
+    Node node = { x, y, layer };
+    auto res = this->ids.insert( std::make_pair( node, this->parent.size()));
+
+    if ( res.second )
+        this->parent.push_back( this->parent.size());
+
+    return res.first->second;
+}
+
+unsigned SolutionChecker::Find( unsigned id)
+{
+    while ( this->parent[ id] != id )
+    {
+        this->parent[ id] = this->parent[ this->parent[ id]];
+        id = this->parent[ id];
+    }
+
+    return id;
+}
+
+void SolutionChecker::Unite( unsigned id1, unsigned id2)
+{
+    this->parent[ this->Find( id1)] = this->Find( id2);
+}
+
+void SolutionChecker::Reset()
+{
+    this->ids.clear();
+    this->parent.clear();
+    this->vias.clear();
+    this->pins.clear();
+    this->wire_length = 0;
+    this->has_segments = false;
+    this->result = Valid;
+}
+
+void SolutionChecker::AddPin( SMT::Coord x, SMT::Coord y)
+{
+    this->pins.push_back( this->GetId( x, y, Pins));
+}
+
+void SolutionChecker::AddSegment( SMT::Coord x1, SMT::Coord y1, SMT::Coord x2, SMT::Coord y2, Layer layer)
+{
+    bool is_horizontal = y1 == y2 && x1 != x2;
+    bool is_vertical = x1 == x2 && y1 != y2;
+
+    this->has_segments = true;
+
+    if ( ( layer == M2 && !is_horizontal )
+         || ( layer == M3 && !is_vertical )
+         || layer == Pins )
+    {
+        if ( this->result == Valid )
+            this->result = BadSegment;
+
+        return;
+    }
+
+    this->Unite( this->GetId( x1, y1, layer), this->GetId( x2, y2, layer));
+
+    /** Length is taken from coordinates, so a wrong edge length isn't trusted */
+    this->wire_length += static_cast<SMT::Length>( x1 > x2 ? x1 - x2 : x2 - x1)
+                         + ( y1 > y2 ? y1 - y2 : y2 - y1);
+}
+
+void SolutionChecker::AddVia( SMT::Coord x, SMT::Coord y, Layer layer)
+{
+    Node via = { x, y, static_cast<unsigned>( layer) };
+
+    if ( !this->vias.insert( via).second )
+    {
+        if ( this->result == Valid )
+            this->result = DuplicateVia;
+
+        return;
+    }
+
+    this->Unite( this->GetId( x, y, layer), this->GetId( x, y, layer + 1));
+}
+
+SolutionChecker::Result SolutionChecker::Check( SMT::Length length)
+{
+    if ( this->smt )
+    {
+        SMT::PointsView points = this->smt->GetPoints();
+        SMT::EdgesView edges = this->smt->GetEdges();
+
+        this->Reset();
+        this->ids.reserve( ( points.size() + edges.size()) * 2);
+
+        for ( auto it = edges.begin();
+              it != edges.end();
+              ++it)
+        {
+            this->AddSegment( ( *it).GetPosX1(), ( *it).GetPosY1(), ( *it).GetPosX2(), ( *it).GetPosY2(),
+                              ( *it).IsInM2Layer() ? M2 : M3);
+        }
+
+        for ( auto it = points.begin();
+              it != points.end();
+              ++it)
+        {
+            if ( ( *it).IsPin() )
+            {
+                this->AddPin( ( *it).GetPosX(), ( *it).GetPosY());
+                continue;
+            }
+
+            if ( ( *it).GetType() != SMT::Point::Pins_M2
+                 && ( *it).GetType() != SMT::Point::M2_M3 )
+                continue;
+
+            this->AddVia( ( *it).GetPosX(), ( *it).GetPosY(), ( *it).IsPinsM2() ? Pins : M2);
+        }
+    }
+
+    if ( this->result != Valid )
+        return this->result;
+
+    for ( auto it = this->pins.begin();
+          it != this->pins.end();
+          ++it)
+    {
+        if ( this->Find( *it) != this->Find( this->pins.front()) )
+            return Disconnected;
+    }
+
+    if ( this->pins.empty()
+         && !this->has_segments )
+        return Valid;
+
+    return length == SMT::no_length || this->wire_length == length ? Valid : WrongLength;
+}
+
+SolutionChecker::SolutionChecker()
+    : smt( nullptr)
+{
+    this->Reset();
+}
+
+SolutionChecker::SolutionChecker( const SMT& smt)
+    : smt( &smt)
+{
+    this->Reset();
+}
@@ -0,0 +1,112 @@
+#ifndef SMT__SOLUTION_CHECKER_H
+#define SMT__SOLUTION_CHECKER_H
+
+#include "smt.h"
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ *  Description for solution checker
+ *
+ *  Solution checker verifies a finalized SMT the way it is written
+ *  out. Segments have to be horizontal (M2) or vertical (M3), points
+ *  are nodes of their layers and vias join layers at the same place.
+ *  All pins have to be connected through segments and vias, and
+ *  the wire length has to match the length reported by the build.
+ *  Nodes are found by coordinate hashing and joined with union-find,
+ *  so checking takes O(m) for m points and segments on average.
+ *
+ *  A solution read back from its text, like a cached one, is checked
+ *  the same way: its parts and pins of the bench are added one by one
+ *  and there is no length to match
+ */
+class SolutionChecker
+{
+
+public:
+
+    /**
+     *  Checking results
+     */
+    enum Result
+    {
+        /** solution is valid */
+        Valid,
+
+        /** segment is diagonal or has zero length */
+        BadSegment,
+
+        /** two vias of the same type at the same place */
+        DuplicateVia,
+
+        /** some pins are not connected to the others */
+        Disconnected,
+
+        /** wire length differs from the reported length */
+        WrongLength
+    };
+
+    /** Layers of nodes, a via is kept as a node of the lower layer it joins */
+    enum Layer
+    {
+        Pins,
+        M2,
+        M3,
+        Layers
+    };
+
+private:
+
+    struct Node
+    {
+        SMT::Coord x;
+        SMT::Coord y;
+        unsigned layer;
+
+        bool operator==( const Node& other) const
+        {
+            return this->x == other.x
+                   && this->y == other.y
+                   && this->layer == other.layer;
+        }
+    };
+
+    struct NodeHash
+    {
+        std::size_t operator()( const Node& node) const;
+    };
+
+    const SMT* smt;
+
+    std::unordered_map<Node, unsigned, NodeHash> ids;
+    std::vector<unsigned> parent;
+    std::unordered_set<Node, NodeHash> vias;
+    std::vector<unsigned> pins;
+    SMT::Length wire_length;
+    bool has_segments;
+
+    /** First error of added parts */
+    Result result;
+
+    unsigned GetId( SMT::Coord x, SMT::Coord y, unsigned layer);
+    unsigned Find( unsigned id);
+    void Unite( unsigned id1, unsigned id2);
+    void Reset();
+
+public:
+
+    /** Checker of added parts */
+    SolutionChecker();
+    SolutionChecker( const SMT& smt);
+
+    void AddPin( SMT::Coord x, SMT::Coord y);
+    void AddSegment( SMT::Coord x1, SMT::Coord y1, SMT::Coord x2, SMT::Coord y2, Layer layer);
+    void AddVia( SMT::Coord x, SMT::Coord y, Layer layer);
+
+    /** Checks the SMT, or added parts if there is none, length isn't matched if it is no_length */
+    Result Check( SMT::Length length);
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "solution_writer.h"
+#include <cstring>
+
+/**
+ *  Pairs of digits for 00..99, so we can emit two digits per division
+ */
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/** Enough for 2^64 - 1 */
+static const std::size_t max_digits = 20;
+
+SolutionWriter::SolutionWriter( std::size_t capacity)
+{
+    this->file = nullptr;
+    this->buffer.resize( capacity < max_digits ? max_digits : capacity);
+    this->used = 0;
+    this->written = 0;
+    this->capture = nullptr;
+    this->failed = false;
+}
+
+SolutionWriter::~SolutionWriter()
+{
+    this->Close();
+}
+
+bool SolutionWriter::Open( const char* path)
+{
+    this->Close();
+
+    this->file = std::fopen( path, "wb");
+    this->written = 0;
+    this->failed = !this->file;
+
+    if ( this->file )
+    {
+        /** We buffer by ourselves */
+        std::setvbuf( this->file, nullptr, _IONBF, 0);
+    }
+
+    return !this->failed;
+}
+
+bool SolutionWriter::Close()
+{
+    if ( !this->file )
+        return !this->failed;
+
+    this->Flush();
+
+    if ( std::fclose( this->file) )
+        this->failed = true;
+
+    this->file = nullptr;
+
+    return !this->failed;
+}
+
+void SolutionWriter::SetCapture( std::string* capture)
+{
+    this->capture = capture;
+}
+
+void SolutionWriter::Flush()
+{
+    /** Captured copy is used to put the solution into the disk cache */
+    if ( this->capture )
+        this->capture->append( this->buffer.data(), this->used);
+
+    if ( this->file
+         && this->used
+         && std::fwrite( &this->buffer[ 0], 1, this->used, this->file) != this->used )
+    {
+        this->failed = true;
+    }
+
+    this->used = 0;
+}
+
+void SolutionWriter::Reserve( std::size_t size)
+{
+    if ( this->used + size > this->buffer.size() )
+        this->Flush();
+}
+
+void SolutionWriter::Append( const char* str, std::size_t size)
+{
+    if ( size > this->buffer.size() )
+    {
+        /** Too big for the buffer, so write it directly */
+        this->Flush();
+
+        if ( this->capture )
+            this->capture->append( str, size);
+
+        if ( this->file
+             && std::fwrite( str, 1, size, this->file) != size )
+        {
+            this->failed = true;
+        }
+
+        this->written += size;
+
+        return;
+    }
+
+    this->Reserve( size);
+    std::memcpy( &this->buffer[ this->used], str, size);
+    this->used += size;
+    this->written += size;
+}
+
+void SolutionWriter::Append( const char* str)
+{
+    this->Append( str, std::strlen( str));
+}
+
+void SolutionWriter::AppendUnsigned( unsigned long long value)
+{
+    char digits[ max_digits];
+    char* pos = digits + max_digits;
+
+    while ( value >= 100 )
+    {
+        unsigned pair = static_cast<unsigned>( value % 100) * 2;
+        value /= 100;
+        pos -= 2;
+        pos[ 0] = digit_pairs[ pair];
+        pos[ 1] = digit_pairs[ pair + 1];
+    }
+
+    if ( value >= 10 )
+    {
+        unsigned pair = static_cast<unsigned>( value) * 2;
+        pos -= 2;
+        pos[ 0] = digit_pairs[ pair];
+        pos[ 1] = digit_pairs[ pair + 1];
+    }
+    else
+    {
+        *--pos = static_cast<char>( '0' + value);
+    }
+
+    this->Append( pos, digits + max_digits - pos);
+}
+
+std::size_t SolutionWriter::GetWrittenBytes()
+{
+    return this->written;
+}
+
+bool SolutionWriter::IsFailed()
+{
+    return this->failed;
+}
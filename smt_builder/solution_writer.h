@@ -0,0 +1,53 @@
+#ifndef SMT__SOLUTION_WRITER_H
+#define SMT__SOLUTION_WRITER_H
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ *  Description for solution writer
+ *
+ *  Writer formats text into a large reusable buffer and passes
+ *  it to the file in few big chunks, so solution output doesn't
+ *  pay for stream formatting and flushing on every field
+ */
+class SolutionWriter
+{
+
+private:
+
+    std::FILE* file;
+    std::vector<char> buffer;
+    std::size_t used;
+    std::size_t written;
+    std::string* capture;
+    bool failed;
+
+    void Reserve( std::size_t size);
+
+public:
+
+    /** Default buffer capacity */
+    static const std::size_t default_capacity = 1 << 20;
+
+    SolutionWriter( std::size_t capacity = default_capacity);
+    ~SolutionWriter();
+    SolutionWriter( const SolutionWriter& other) = delete;
+    SolutionWriter& operator=( const SolutionWriter& other) = delete;
+
+    bool Open( const char* path);
+    bool Close();
+    void Flush();
+    void SetCapture( std::string* capture);
+
+    void Append( const char* str, std::size_t size);
+    void Append( const char* str);
+    void AppendUnsigned( unsigned long long value);
+
+    std::size_t GetWrittenBytes();
+    bool IsFailed();
+};
+
+#endif
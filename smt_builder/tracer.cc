@@ -0,0 +1,168 @@
+#include "tracer.h"
+#include <fstream>
+
+/** Tracer and buffer of the current thread */
+static thread_local Tracer* current_tracer = nullptr;
+static thread_local void* current_buffer = nullptr;
+
+/**
+ * ------ Tracer::Scope ------
+ */
+
+
+Tracer::Scope::Scope( const char* name,
+                      unsigned long long net,
+                      const char* arg_name,
+                      unsigned long long arg)
+{
+    Tracer& tracer = Tracer::GetInstance();
+
+    this->tracer = nullptr;
+
+    if ( !tracer.IsEnabled() )
+        return;
+
+    this->tracer = &tracer;
+    this->name = name;
+    this->net = net;
+    this->arg_name = arg_name;
+    this->arg = arg;
+    this->start = Clock::now();
+}
+
+Tracer::Scope::~Scope()
+{
+    if ( this->tracer )
+        this->tracer->Record( this->name, this->net, this->arg_name, this->arg, this->start, Clock::now());
+}
+
+
+/**
+ * ------ Tracer ------
+ */
+
+
+Tracer::Tracer()
+{
+    this->is_enabled = false;
+    this->capacity = default_capacity;
+    this->epoch = Clock::now();
+}
+
+Tracer& Tracer::GetInstance()
+{
+    static Tracer instance;
+    return instance;
+}
+
+void Tracer::Enable( std::size_t capacity)
+{
+    std::lock_guard<std::mutex> guard( this->lock);
+
+    /** Buffers made before keep their size */
+    this->capacity = capacity ? capacity : 1;
+    this->is_enabled.store( true, std::memory_order_relaxed);
+}
+
+void Tracer::Disable()
+{
+    this->is_enabled.store( false, std::memory_order_relaxed);
+}
+
+bool Tracer::IsEnabled() const
+{
+    return this->is_enabled.load( std::memory_order_relaxed);
+}
+
+Tracer::Buffer* Tracer::GetBuffer()
+{
+    if ( current_tracer == this )
+        return static_cast<Buffer*>( current_buffer);
+
+    std::lock_guard<std::mutex> guard( this->lock);
+    Buffer* buffer = new Buffer;
+
+    buffer->id = this->buffers.size() + 1;
+    buffer->events.resize( this->capacity);
+    buffer->count = 0;
+    this->buffers.push_back( std::unique_ptr<Buffer>( buffer));
+
+    current_tracer = this;
+    current_buffer = buffer;
+
+    return buffer;
+}
+
+void Tracer::Record( const char* name,
+                     unsigned long long net,
+                     const char* arg_name,
+                     unsigned long long arg,
+                     Clock::time_point start,
+                     Clock::time_point end)
+{
+    Buffer* buffer = this->GetBuffer();
+    unsigned long long count = buffer->count.load( std::memory_order_relaxed);
+    Event& event = buffer->events[ count % buffer->events.size()];
+
+    event.name = name;
+    event.net = net;
+    event.arg_name = arg_name;
+    event.arg = arg;
+    event.start = start;
+    event.end = end;
+
+    buffer->count.store( count + 1, std::memory_order_release);
+}
+
+bool Tracer::Write( const char* path, unsigned long long pid)
+{
+    std::lock_guard<std::mutex> guard( this->lock);
+    std::ofstream output( path);
+    bool is_first = true;
+
+    /** Times are in microseconds, nanoseconds are kept as fractions */
+    output.setf( std::ios::fixed);
+    output.precision( 3);
+
+    output << "{\"traceEvents\": [";
+
+    for ( auto it = this->buffers.begin();
+          it != this->buffers.end();
+          ++it)
+    {
+        Buffer& buffer = **it;
+        unsigned long long count = buffer.count.load( std::memory_order_acquire);
+        unsigned long long size = buffer.events.size();
+        unsigned long long first = count > size ? count - size : 0;
+
+        output << ( is_first ? "\n" : ",\n")
+               << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid
+               << ", \"tid\": " << buffer.id
+               << ", \"args\": {\"name\": \"thread " << buffer.id << "\"}}";
+        is_first = false;
+
+        for ( unsigned long long i = first; i < count; ++i)
+        {
+            const Event& event = buffer.events[ i % size];
+            double start = std::chrono::duration<double, std::micro>( event.start - this->epoch).count();
+            double duration = std::chrono::duration<double, std::micro>( event.end - event.start).count();
+
+            output << ",\n{\"name\": \"" << event.name
+                   << "\", \"ph\": \"X\", \"pid\": " << pid
+                   << ", \"tid\": " << buffer.id
+                   << ", \"ts\": " << start
+                   << ", \"dur\": " << duration
+                   << ", \"args\": {\"net\": " << event.net;
+
+            if ( event.arg_name )
+                output << ", \"" << event.arg_name << "\": " << event.arg;
+
+            output << "}}";
+        }
+    }
+
+    output << "\n]}\n";
+    output.close();
+
+    return !output.fail();
+}
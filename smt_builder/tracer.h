@@ -0,0 +1,104 @@
+#ifndef SMT__TRACER_H
+#define SMT__TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ *  Description for tracer
+ *
+ *  Tracer records scoped events of the solver into a ring buffer per
+ *  thread and writes them as Chrome trace JSON, which opens in
+ *  Perfetto and chrome://tracing. Threads never share a buffer, so
+ *  recording takes no locks, and when tracing is disabled a scope
+ *  costs one flag check. Ring buffers keep the newest events only.
+ *
+ *  Event names are string literals, they are stored as pointers.
+ *  Trace is written when traced work is over
+ */
+class Tracer
+{
+
+public:
+
+    typedef std::chrono::steady_clock Clock;
+
+    static const std::size_t default_capacity = 1 << 16;
+
+    /**
+     *  Scope records an event from its construction to its destruction
+     */
+    class Scope
+    {
+
+    private:
+
+        Tracer* tracer;
+        const char* name;
+        unsigned long long net;
+        const char* arg_name;
+        unsigned long long arg;
+        Clock::time_point start;
+
+    public:
+
+        Scope( const char* name, unsigned long long net, const char* arg_name = nullptr, unsigned long long arg = 0);
+        ~Scope();
+        Scope( const Scope& other) = delete;
+        Scope& operator=( const Scope& other) = delete;
+    };
+
+private:
+
+    struct Event
+    {
+        const char* name;
+        unsigned long long net;
+        const char* arg_name;
+        unsigned long long arg;
+        Clock::time_point start;
+        Clock::time_point end;
+    };
+
+    struct Buffer
+    {
+        unsigned id;
+        std::vector<Event> events;
+        std::atomic<unsigned long long> count;
+    };
+
+    std::mutex lock;
+    std::vector<std::unique_ptr<Buffer> > buffers;
+    std::atomic<bool> is_enabled;
+    std::size_t capacity;
+    Clock::time_point epoch;
+
+    Buffer* GetBuffer();
+
+public:
+
+    Tracer();
+    Tracer( const Tracer& other) = delete;
+    Tracer& operator=( const Tracer& other) = delete;
+
+    static Tracer& GetInstance();
+
+    void Enable( std::size_t capacity = default_capacity);
+    void Disable();
+    bool IsEnabled() const;
+
+    void Record( const char* name,
+                 unsigned long long net,
+                 const char* arg_name,
+                 unsigned long long arg,
+                 Clock::time_point start,
+                 Clock::time_point end);
+
+    bool Write( const char* path, unsigned long long pid);
+};
+
+#endif